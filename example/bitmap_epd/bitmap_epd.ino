@@ -22,13 +22,12 @@
  */
 
 #include <cstdint>
-#include <cstring>
 #include <Arduino.h>
 #include <SPI.h>
+#include "Canvas.hpp"
 #include "EpaperDriver.hpp"
 
 using std::uint8_t;
-using std::size_t;
 
 
 static constexpr int MAX_WIDTH  = 264;
@@ -79,7 +78,7 @@ static const uint8_t *(IMAGES[]) = {
 	IMAGE_4,
 };
 
-static const size_t SOURCE_WIDTH = 264;
+static constexpr int SOURCE_WIDTH = 264;
 
 
 static uint8_t image[MAX_WIDTH * MAX_HEIGHT / 8];
@@ -93,16 +92,9 @@ void loop() {
 	int width = epd.getWidth();
 	int height = epd.getHeight();
 	
-	// Render image to memory
-	std::memset(image, 0, sizeof(image));
-	for (int y = 0; y < height; y++) {
-		for (int x = 0; x < width; x++) {
-			size_t j = static_cast<size_t>(y) * static_cast<size_t>(SOURCE_WIDTH) + static_cast<size_t>(x);
-			int c = (IMAGES[imageIndex][j / 8] >> (j % 8)) & 1;
-			size_t i = static_cast<size_t>(y) * static_cast<size_t>(width) + static_cast<size_t>(x);
-			image[i / 8] |= c << (i % 8);
-		}
-	}
+	// Render image to memory, cropping the source to the panel size
+	Canvas canvas(image, width, height);
+	canvas.blit(0, 0, IMAGES[imageIndex], SOURCE_WIDTH / 8, 0, 0, width, height, Canvas::BlitMode::COPY);
 	
 	// Draw image to screen
 	epd.changeImage(image);
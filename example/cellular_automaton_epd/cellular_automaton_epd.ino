@@ -68,46 +68,69 @@ void setup() {
 }
 
 
-static uint8_t image[MAX_WIDTH * MAX_HEIGHT / 8];
+// The state of the row source: a lookup table of the rule, and the last row rendered.
+struct Automaton {
+	// next[w] is the byte of 8 cells whose 10 neighbors in the row above are the bits of w
+	// (bit k of w is the cell at offset k - 1 from the first cell of the byte).
+	uint8_t next[1024];
+	uint8_t row[MAX_WIDTH / 8];  // The cells of row lastRow
+	int lastRow;  // -1 if none
+};
+
+static Automaton automaton;
 static size_t ruleIndex = 0;
 
+
+// Builds the lookup table for the given elementary cellular automaton rule.
+static void initAutomaton(Automaton &ca, uint8_t rule) {
+	for (int w = 0; w < 1024; w++) {
+		uint8_t b = 0;
+		for (int j = 0; j < 8; j++) {
+			int context = (w >> j) & 7;  // Left neighbor in bit 0, right neighbor in bit 2
+			context = (context & 1) << 2 | (context & 2) | (context >> 2);
+			b |= ((rule >> context) & 1) << j;
+		}
+		ca.next[w] = b;
+	}
+	ca.lastRow = -1;
+}
+
+
+// Renders one row of the automaton on demand, so that no image array is needed. Each row
+// follows from the one above, so the rows are computed in order (the driver asks for them
+// top to bottom in each frame), starting over from the top row when an earlier row is asked for.
+static void renderRow(int y, uint8_t pixels[], void *context) {
+	Automaton &ca = *static_cast<Automaton *>(context);
+	int width = epd.getWidth();
+	int bytesPerLine = width / 8;
+	if (y <= ca.lastRow)
+		ca.lastRow = -1;
+	for (; ca.lastRow < y; ca.lastRow++) {
+		if (ca.lastRow == -1) {  // The top row has one black cell
+			std::memset(ca.row, 0, sizeof(ca.row));
+			int x = width * 2 / 3;
+			ca.row[x / 8] |= 1 << (x % 8);
+			continue;
+		}
+		uint8_t above[MAX_WIDTH / 8 + 2] = {};  // With a white cell beyond each end
+		std::memcpy(&above[1], ca.row, bytesPerLine * sizeof(ca.row[0]));
+		for (int i = 0; i < bytesPerLine; i++) {
+			int w = above[i] >> 7 | above[i + 1] << 1 | (above[i + 2] & 1) << 9;
+			ca.row[i] = ca.next[w];
+		}
+	}
+	std::memcpy(pixels, ca.row, bytesPerLine * sizeof(pixels[0]));
+}
+
+
 void loop() {
 	uint8_t rule = DEMO_RULES[ruleIndex];
 	Serial.print("rule = ");
 	Serial.println(rule);
 	
-	// Scalar constants
-	int width = epd.getWidth();
-	int height = epd.getHeight();
-	
-	// Render image to memory
-	std::memset(image, 0, sizeof(image));
-	for (int y = 0; y < height; y++) {
-		for (int x = 0; x < width; x++) {
-			size_t i = static_cast<size_t>(y) * static_cast<size_t>(width) + static_cast<size_t>(x);
-			int c;
-			if (y == 0)
-				c = x == width * 2 / 3 ? 1 : 0;
-			else {  // y > 0
-				int context = 0;
-				size_t j = i - static_cast<size_t>(width) - 1;
-				if (x > 0)
-					context = (image[j / 8] >> (j % 8)) & 1;
-				context <<= 1;
-				j++;
-				context |= (image[j / 8] >> (j % 8)) & 1;
-				context <<= 1;
-				j++;
-				if (x < width - 1)
-					context |= (image[j / 8] >> (j % 8)) & 1;
-				c = (rule >> context) & 1;
-			}
-			image[i / 8] |= c << (i % 8);
-		}
-	}
-	
-	// Draw image to screen
-	epd.changeImage(image);
+	// Draw image to screen, rendering each row as the driver needs it
+	initAutomaton(automaton, rule);
+	epd.changeImage(renderRow, &automaton);
 	delay(5000);
 	
 	// Change parameters for next iteration
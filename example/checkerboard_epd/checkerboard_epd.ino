@@ -28,7 +28,6 @@
 #include "EpaperDriver.hpp"
 
 using std::uint8_t;
-using std::size_t;
 
 
 static constexpr int MAX_WIDTH  = 264;
@@ -65,29 +64,43 @@ void setup() {
 }
 
 
-static uint8_t image[MAX_WIDTH * MAX_HEIGHT / 8];
+// The two alternating rows of the current checkerboard, so that rendering a row is a copy.
+struct Checkerboard {
+	int size;
+	uint8_t rows[2][MAX_WIDTH / 8];
+};
+
+static Checkerboard checkerboard;
 static int checkerSize = 1;
 
+
+// Precomputes the two rows of the checkerboard with the given square size.
+static void initCheckerboard(Checkerboard &board, int size) {
+	board.size = size;
+	int width = epd.getWidth();
+	std::memset(board.rows, 0, sizeof(board.rows));
+	for (int x = 0; x < width; x++) {
+		int c = (x / size) % 2;
+		board.rows[c][x / 8] |= 1 << (x % 8);
+	}
+}
+
+
+// Renders one row of the checkerboard on demand, so that no image array is needed. The driver
+// calls this for every row of every frame, so it only copies one of the precomputed rows.
+static void renderRow(int y, uint8_t pixels[], void *context) {
+	const Checkerboard &board = *static_cast<const Checkerboard *>(context);
+	std::memcpy(pixels, board.rows[(y / board.size + 1) % 2], epd.getBytesPerLine() * sizeof(pixels[0]));
+}
+
+
 void loop() {
 	Serial.print("checkerSize = ");
 	Serial.println(checkerSize);
 	
-	// Scalar constants
-	int width = epd.getWidth();
-	int height = epd.getHeight();
-	
-	// Render image to memory
-	std::memset(image, 0, sizeof(image));
-	for (int y = 0; y < height; y++) {
-		for (int x = 0; x < width; x++) {
-			size_t i = static_cast<size_t>(y) * static_cast<size_t>(width) + static_cast<size_t>(x);
-			int c = (x / checkerSize + y / checkerSize) % 2;
-			image[i / 8] |= c << (i % 8);
-		}
-	}
-	
-	// Draw image to screen
-	epd.changeImage(image);
+	// Draw image to screen, rendering each row as the driver needs it
+	initCheckerboard(checkerboard, checkerSize);
+	epd.changeImage(renderRow, &checkerboard);
 	delay(3000);
 	
 	// Change parameters for next iteration
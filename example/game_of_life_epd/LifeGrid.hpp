@@ -0,0 +1,305 @@
+/* 
+ * Game of Life board for the e-paper display demo program
+ * 
+ * Copyright (c) Project Nayuki. (MIT License)
+ * https://www.nayuki.io/page/pervasive-displays-epaper-panel-hardware-driver
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * - The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ * - The Software is provided "as is", without warranty of any kind, express or
+ *   implied, including but not limited to the warranties of merchantability,
+ *   fitness for a particular purpose and noninfringement. In no event shall the
+ *   authors or copyright holders be liable for any claim, damages or other
+ *   liability, whether in an action of contract, tort or otherwise, arising from,
+ *   out of or in connection with the Software or the use or other dealings in the
+ *   Software.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+
+/* 
+ * A Game of Life board (rule B3/S23) on a torus, which is stepped a whole word of cells at a time.
+ * Each row is stored in wordsPerRow words, where cell x is bit (x % WORD_BITS) of word
+ * (x / WORD_BITS), and the unused bits of the last word are kept 0. A generation is computed
+ * for each word with bit-sliced adders: every bit position is an independent neighbor counter,
+ * so the counts of all cells of the word come from the same few dozen logical operations.
+ * The neighbors to the left and right are the row shifted by one bit, wrapping around at
+ * the edges, and the board is updated in place using three row buffers.
+ * 
+ * The board is divided into tiles of one word by TILE_ROWS rows, and a step only recomputes
+ * the tiles that changed in the previous step and their neighbors, because the other cells
+ * can't change. So the cost of a step follows the activity, and a board that has settled into
+ * still lifes costs almost nothing. The step also records which rows changed (for re-rendering
+ * only those rows), and keeps a hash of the board, updated for each changed word, to detect
+ * when the board repeats itself with period 1 or 2 (still lifes and blinkers).
+ * 
+ * Word is an unsigned integer type: std::uint32_t suits 32-bit microcontrollers, and
+ * std::uint64_t suits 64-bit hosts.
+ */
+template <typename Word>
+class LifeGridT final {
+	
+	/*---- Fields ----*/
+	
+	public: static constexpr int WORD_BITS = static_cast<int>(sizeof(Word) * 8);
+	
+	// The largest width, which is the widest panel at one pixel per cell.
+	public: static constexpr int MAX_WIDTH = 264;
+	public: static constexpr int MAX_HEIGHT = 176;
+	public: static constexpr int MAX_ROW_WORDS = (MAX_WIDTH + WORD_BITS - 1) / WORD_BITS;
+	
+	public: static constexpr int TILE_ROWS = 8;
+	private: static constexpr int MAX_BANDS = (MAX_HEIGHT + TILE_ROWS - 1) / TILE_ROWS;
+	
+	private: Word *data;
+	private: int width;
+	private: int height;
+	private: int wordsPerRow;
+	
+	// Bit i of changedTiles[b] is set if the tile of word i in rows [b * TILE_ROWS, (b + 1) * TILE_ROWS)
+	// changed in the last step (or by setCell() since then), and bit (y % 8) of changedRows[y / 8] if row y did.
+	private: std::uint16_t changedTiles[MAX_BANDS] = {};
+	private: std::uint8_t changedRows[MAX_HEIGHT / 8] = {};
+	
+	// The sum of mixWord() over all words, its values before the last two steps, and how many of those are valid.
+	private: std::uint32_t hash = 0;
+	private: std::uint32_t hashHistory[2] = {};
+	private: int historyLength = 0;
+	private: int period = 0;  // See getPeriod()
+	
+	
+	
+	/*---- Constructor ----*/
+	
+	// Creates an empty board with the given dimensions (width in the range [2, MAX_WIDTH], height
+	// in the range [2, MAX_HEIGHT]) in the given array, which must have length getWordCount(width, height).
+	public: LifeGridT(Word buf[], int w, int h) :
+			data(buf),
+			width(w),
+			height(h),
+			wordsPerRow((w + WORD_BITS - 1) / WORD_BITS) {
+		std::memset(data, 0, static_cast<std::size_t>(wordsPerRow) * height * sizeof(data[0]));
+		for (int i = 0; i < wordsPerRow * height; i++)
+			hash += mixWord(0, i);
+		std::memset(changedTiles, 0xFF, sizeof(changedTiles));
+		std::memset(changedRows, 0xFF, sizeof(changedRows));
+	}
+	
+	
+	public: static constexpr int getWordCount(int w, int h) {
+		return (w + WORD_BITS - 1) / WORD_BITS * h;
+	}
+	
+	
+	
+	/*---- Cell methods ----*/
+	
+	public: int getWidth() const {
+		return width;
+	}
+	
+	
+	public: int getHeight() const {
+		return height;
+	}
+	
+	
+	public: int getWordsPerRow() const {
+		return wordsPerRow;
+	}
+	
+	
+	// Returns the words of the given row, which must be in bounds.
+	public: const Word *getRow(int y) const {
+		return &data[y * wordsPerRow];
+	}
+	
+	
+	// Stores the cells of the given row, which must be in bounds, into the given array of
+	// (getWidth() + 7) / 8 bytes, packed least significant bit first (as Canvas::blitScaled() reads).
+	public: void getRowBits(int y, std::uint8_t out[]) const {
+		const Word *row = getRow(y);
+		for (int i = 0; i * 8 < width; i++)
+			out[i] = static_cast<std::uint8_t>(row[i * 8 / WORD_BITS] >> (i * 8 % WORD_BITS));
+	}
+	
+	
+	// Returns 0 or 1 if (x, y) is in bounds, otherwise returns 0.
+	public: int getCell(int x, int y) const {
+		if (x < 0 || x >= width || y < 0 || y >= height)
+			return 0;
+		return static_cast<int>((data[y * wordsPerRow + x / WORD_BITS] >> (x % WORD_BITS)) & 1);
+	}
+	
+	
+	// (x, y) must be in bounds and val must be 0 or 1, otherwise the method does nothing.
+	// Marks the cell's row and tile as changed, and restarts the detection of steady states.
+	public: void setCell(int x, int y, int val) {
+		if (x < 0 || x >= width || y < 0 || y >= height || (val != 0 && val != 1))
+			return;
+		int i = y * wordsPerRow + x / WORD_BITS;
+		Word bit = static_cast<Word>(1) << (x % WORD_BITS);
+		setWord(i, val != 0 ? (data[i] | bit) : (data[i] & ~bit));
+		historyLength = 0;
+		period = 0;
+	}
+	
+	
+	// Returns whether the given row changed in the last step (or by setCell() since then).
+	// Every row counts as changed before the first step.
+	public: bool isRowChanged(int y) const {
+		return ((changedRows[y / 8] >> (y % 8)) & 1) != 0;
+	}
+	
+	
+	// Returns 1 if the last step changed nothing, or 2 if it returned the board to its state
+	// two generations ago (as compared by hash, so with a false match chance of about 2^-32),
+	// otherwise 0. Once this is not 0, the board repeats with that period forever.
+	public: int getPeriod() const {
+		return period;
+	}
+	
+	
+	
+	/*---- Simulation ----*/
+	
+	// Replaces the board with its next generation.
+	public: void step() {
+		// A cell can only change if a cell of its neighborhood changed in the last step, so only the
+		// tiles that changed and their 8 neighbors (wrapping around the edges) are recomputed
+		int bands = (height + TILE_ROWS - 1) / TILE_ROWS;
+		unsigned int allWords = (1U << wordsPerRow) - 1;
+		std::uint16_t active[MAX_BANDS];
+		for (int b = 0; b < bands; b++) {
+			unsigned int m = changedTiles[(b + bands - 1) % bands] | changedTiles[b] | changedTiles[(b + 1) % bands];
+			m |= (m << 1 | m >> (wordsPerRow - 1)) | (m >> 1 | m << (wordsPerRow - 1));
+			active[b] = static_cast<std::uint16_t>(m & allWords);
+		}
+		std::memset(changedTiles, 0, sizeof(changedTiles));
+		std::memset(changedRows, 0, sizeof(changedRows));
+		hashHistory[1] = hashHistory[0];
+		hashHistory[0] = hash;
+		if (historyLength < 2)
+			historyLength++;
+		
+		Word above[MAX_ROW_WORDS];  // Row y - 1 of the current generation
+		Word cur  [MAX_ROW_WORDS];  // Row y of the current generation
+		Word first[MAX_ROW_WORDS];  // Row 0 of the current generation, which is below the last row
+		std::size_t rowBytes = static_cast<std::size_t>(wordsPerRow) * sizeof(Word);
+		std::memcpy(above, &data[(height - 1) * wordsPerRow], rowBytes);
+		std::memcpy(first, data, rowBytes);
+		for (int y = 0; y < height; y++) {
+			Word *row = &data[y * wordsPerRow];
+			std::memcpy(cur, row, rowBytes);
+			const Word *below = y + 1 < height ? &data[(y + 1) * wordsPerRow] : first;
+			stepRow(y, active[y / TILE_ROWS], above, cur, below);
+			std::memcpy(above, cur, rowBytes);
+		}
+		
+		bool anyChanged = false;
+		for (int b = 0; b < bands; b++)
+			anyChanged = anyChanged || changedTiles[b] != 0;
+		if (!anyChanged)
+			period = 1;
+		else
+			period = historyLength == 2 && hash == hashHistory[1] ? 2 : 0;
+	}
+	
+	
+	// Computes the next generation of the words of row y selected by the given mask,
+	// from the current rows above, at and below it, and stores the changed words.
+	private: void stepRow(int y, unsigned int mask, const Word above[], const Word cur[], const Word below[]) {
+		for (int i = 0; i < wordsPerRow; i++) {
+			if (((mask >> i) & 1) == 0)
+				continue;
+			// Sum the three cells of the rows above and below (0 to 3 each),
+			// and the two side cells of the middle row (0 to 2), as 2-bit numbers
+			Word aw, ae, bw, be, cw, ce;
+			shiftedNeighbors(above, i, &aw, &ae);
+			shiftedNeighbors(below, i, &bw, &be);
+			shiftedNeighbors(cur  , i, &cw, &ce);
+			Word a0, a1, b0, b1;
+			fullAdd(aw, above[i], ae, &a0, &a1);
+			fullAdd(bw, below[i], be, &b0, &b1);
+			Word m0 = cw ^ ce;
+			Word m1 = cw & ce;
+			
+			// Add them into the neighbor count n2:n1:n0 (modulo 8, so 8 neighbors read as 0)
+			Word n0, c0, t, c1;
+			fullAdd(a0, b0, m0, &n0, &c0);
+			fullAdd(a1, b1, m1, &t, &c1);
+			Word n1 = t ^ c0;
+			Word n2 = c1 ^ (t & c0);
+			
+			// Alive with 3 neighbors, or with 2 if already alive
+			Word next = n1 & ~n2 & (n0 | cur[i]);
+			if (i == wordsPerRow - 1)
+				next &= lastWordMask();
+			if (next != cur[i])
+				setWord(y * wordsPerRow + i, next);
+		}
+	}
+	
+	
+	// Stores the given value at the given index of data, updating the hash and marking the row and tile as changed.
+	private: void setWord(int index, Word val) {
+		hash += mixWord(val, index) - mixWord(data[index], index);
+		data[index] = val;
+		int y = index / wordsPerRow;
+		changedTiles[y / TILE_ROWS] |= static_cast<std::uint16_t>(1U << (index % wordsPerRow));
+		changedRows[y / 8] |= static_cast<std::uint8_t>(1U << (y % 8));
+	}
+	
+	
+	// Returns a well-mixed hash of the given word at the given index of data.
+	private: static std::uint32_t mixWord(Word val, int index) {
+		std::uint64_t x = static_cast<std::uint64_t>(val) * UINT64_C(0x9E3779B97F4A7C15)
+			+ static_cast<std::uint64_t>(index) * UINT64_C(0xC2B2AE3D27D4EB4F);
+		x ^= x >> 31;
+		x *= UINT64_C(0xBF58476D1CE4E5B9);
+		x ^= x >> 29;
+		return static_cast<std::uint32_t>(x >> 32);
+	}
+	
+	
+	// Sets *west to the left neighbors and *east to the right neighbors of the cells
+	// of word i of the given row, i.e. the row shifted by one cell with wraparound.
+	private: void shiftedNeighbors(const Word row[], int i, Word *west, Word *east) const {
+		int last = wordsPerRow - 1;
+		Word carryIn = i > 0 ? row[i - 1] >> (WORD_BITS - 1)
+			: (row[last] >> ((width - 1) % WORD_BITS)) & 1;  // Cell width - 1
+		*west = static_cast<Word>(row[i] << 1) | carryIn;
+		if (i < last)
+			*east = (row[i] >> 1) | static_cast<Word>(row[i + 1] << (WORD_BITS - 1));
+		else  // Cell 0 goes to the right of cell width - 1
+			*east = (row[i] >> 1) | static_cast<Word>((row[0] & 1) << ((width - 1) % WORD_BITS));
+	}
+	
+	
+	// Sets *sum and *carry to the bits of a + b + c for each bit position.
+	private: static void fullAdd(Word a, Word b, Word c, Word *sum, Word *carry) {
+		Word t = a ^ b;
+		*sum = t ^ c;
+		*carry = (a & b) | (t & c);
+	}
+	
+	
+	private: Word lastWordMask() const {
+		int used = width - (wordsPerRow - 1) * WORD_BITS;
+		return used == WORD_BITS ? ~static_cast<Word>(0) : (static_cast<Word>(1) << used) - 1;
+	}
+	
+};
+
+
+using LifeGrid = LifeGridT<std::uint32_t>;
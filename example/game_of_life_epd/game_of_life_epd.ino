@@ -22,13 +22,14 @@
  */
 
 #include <cstdint>
-#include <cstring>
 #include <Arduino.h>
 #include <SPI.h>
+#include "Canvas.hpp"
 #include "EpaperDriver.hpp"
+#include "LifeGrid.hpp"
 
 using std::uint8_t;
-using std::size_t;
+using std::uint32_t;
 
 
 static constexpr int MAX_WIDTH  = 264;
@@ -39,34 +40,11 @@ static int imageWidth  = epd.getWidth ();
 static int imageHeight = epd.getHeight();
 
 
-class BitGrid final {
-	public: uint8_t *data;  // Must have length ceil(width * height / 8), and have all elements initialized.
-	public: int width;      // Must be non-negative.
-	public: int height;     // Must be non-negative.
-	
-	// Returns 0 or 1 if (x, y) is in bounds, otherwise returns 0.
-	public: int getCell(int x, int y) const {
-		if (x < 0 || x >= width || y < 0 || y >= height)
-			return 0;
-		int i = y * width + x;
-		return (data[i >> 3] >> (i & 7)) & 1;
-	}
-	
-	// (x, y) must be in bounds and val must be 0 or 1, otherwise the method does nothing.
-	public: void setCell(int x, int y, int val) {
-		if (x < 0 || x >= width || y < 0 || y >= height || (val != 0 && val != 1))
-			return;
-		int i = y * width + x;
-		data[i >> 3] &= ~(1 << (i & 7));
-		data[i >> 3] |= val << (i & 7);
-	}
-};
-
-static constexpr int boardScale = 6;  // Must be at least 2
+static constexpr int boardScale = 6;  // Must be in the range [2, 8]
 static constexpr int boardWidth  = (MAX_WIDTH  - 1 + (boardScale - 1)) / boardScale;
 static constexpr int boardHeight = (MAX_HEIGHT - 1 + (boardScale - 1)) / boardScale;
-static uint8_t boardData[(boardWidth * boardHeight + 7) / 8] = {};
-static BitGrid board;
+static uint32_t boardData[LifeGrid::getWordCount(boardWidth, boardHeight)];
+static LifeGrid board(boardData, boardWidth, boardHeight);
 
 
 void setup() {
@@ -92,81 +70,66 @@ void setup() {
 	#endif
 	
 	epd.setFrameTime(800);
-	board.data = boardData;
-	board.width = boardWidth;
-	board.height = boardHeight;
-	
-	// Initialize the grid randomly
 	randomSeed(analogRead(0));
-	for (int y = 0; y < boardHeight; y++) {
-		for (int x = 0; x < boardWidth; x++)
-			board.setCell(x, y, random(100) < 30 ? 1 : 0);
-	}
+	randomizeBoard();
 	delay(1000);
 }
 
 
 static uint8_t image[MAX_WIDTH * MAX_HEIGHT / 8];
 static int remainingUpdates = 0;
+static int steadyLoops = 0;
 
 void loop() {
-	// Render image to memory
-	std::memset(image, 0, sizeof(image));
-	for (int y = 0; y < imageHeight; y++) {
-		for (int x = 0; x < imageWidth; x++) {
-			size_t i = static_cast<size_t>(y) * static_cast<size_t>(imageWidth) + static_cast<size_t>(x);
-			int c;
-			if (x % boardScale == 0 || y % boardScale == 0)
-				c = 1;
-			else
-				c = board.getCell(x / boardScale, y / boardScale);
-			image[i / 8] |= c << (i % 8);
+	// Once the board only repeats itself (still lifes and blinkers), stop refreshing the panel,
+	// and after a while start over with a new random board, drawn with a full image change
+	if (board.getPeriod() != 0) {
+		epd.endSession();
+		if (steadyLoops < 30) {
+			steadyLoops++;
+			delay(1000);
+			return;
 		}
+		steadyLoops = 0;
+		randomizeBoard();
+		remainingUpdates = 0;
 	}
 	
-	// Draw image to screen
+	// Render to memory only the rows of cells that changed in the last step (all of them after randomizing),
+	// each cell enlarged to a block with a black grid line along its top and left edges
+	Canvas canvas(image, imageWidth, imageHeight);
+	for (int y = 0; y < boardHeight; y++) {
+		if (!board.isRowChanged(y))
+			continue;
+		uint8_t rowBits[(boardWidth + 7) / 8];
+		board.getRowBits(y, rowBits);
+		canvas.blitScaled(0, y * boardScale, rowBits, sizeof(rowBits), boardWidth, 1, boardScale, true);
+	}
+	
+	// Start drawing image to screen. Each run of updates keeps the panel powered on,
+	// and an update only drives the pixel rows that differ from the previous image
+	EpaperDriver::Status st;
 	if (remainingUpdates <= 0) {
-		epd.changeImage(image);
+		epd.endSession();
+		epd.beginSession();
+		st = epd.beginChange(image);
 		remainingUpdates = 30;
 	} else {
-		epd.updateImage(image);
+		st = epd.beginUpdate(image);
 		remainingUpdates--;
 	}
 	
-	// Compute next board state
-	nextGameOfLifeState();
+	// Compute next board state while the panel is drawing, then finish drawing
+	board.step();
+	while (st == EpaperDriver::Status::IN_PROGRESS)
+		st = epd.poll();
 }
 
 
-static void nextGameOfLifeState() {
-	int rowBytes = (boardWidth + 7) / 8;
-	uint8_t newTopRow [rowBytes];
-	uint8_t newPrevRow[rowBytes];
-	uint8_t newCurRow [rowBytes];
-	
+// Fills the board randomly, which marks every row as changed.
+static void randomizeBoard() {
 	for (int y = 0; y < boardHeight; y++) {
-		std::memset(newCurRow, 0, sizeof(newCurRow));
-		for (int x = 0; x < boardWidth; x++) {
-			int sum = -board.getCell(x, y);
-			for (int dy = -1; dy <= 1; dy++) {
-				for (int dx = -1; dx <= 1; dx++) {
-					int xx = (x + dx + boardWidth ) % boardWidth ;
-					int yy = (y + dy + boardHeight) % boardHeight;
-					sum += board.getCell(xx, yy);
-				}
-			}
-			bool alive = board.getCell(x, y) != 0;
-			newCurRow[x >> 3] |= (sum == 3 || (alive && sum == 2) ? 1 : 0) << (x & 7);
-		}
-		
-		if (y >= 2) {
-			for (int x = 0; x < boardWidth; x++)
-				board.setCell(x, y - 1, (newPrevRow[x >> 3] >> (x & 7)) & 1);
-		}
-		std::memcpy(y == 0 ? newTopRow : newPrevRow, newCurRow, sizeof(newCurRow));
-	}
-	for (int x = 0; x < boardWidth; x++) {
-		board.setCell(x, 0, (newTopRow[x >> 3] >> (x & 7)) & 1);
-		board.setCell(x, boardHeight - 1, (newPrevRow[x >> 3] >> (x & 7)) & 1);
+		for (int x = 0; x < boardWidth; x++)
+			board.setCell(x, y, random(100) < 30 ? 1 : 0);
 	}
 }
@@ -113,7 +113,9 @@ void loop() {
 	uint64_t scale      = param.scale     ;
 	uint32_t iterations = param.iterations;
 	
-	// Render image to memory
+	// Render image to memory once. (A row source would have to recompute each row for every frame
+	// that the driver draws, and a row can take many milliseconds to compute, so this sketch keeps
+	// the image array.)
 	std::memset(image, 0, sizeof(image));
 	for (int y = 0; y < HEIGHT; y++) {
 		for (int x = 0; x < WIDTH; x++) {
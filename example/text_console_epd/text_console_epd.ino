@@ -0,0 +1,88 @@
+/* 
+ * Demo program for e-paper display hardware driver
+ * 
+ * Copyright (c) Project Nayuki. (MIT License)
+ * https://www.nayuki.io/page/pervasive-displays-epaper-panel-hardware-driver
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * - The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ * - The Software is provided "as is", without warranty of any kind, express or
+ *   implied, including but not limited to the warranties of merchantability,
+ *   fitness for a particular purpose and noninfringement. In no event shall the
+ *   authors or copyright holders be liable for any claim, damages or other
+ *   liability, whether in an action of contract, tort or otherwise, arising from,
+ *   out of or in connection with the Software or the use or other dealings in the
+ *   Software.
+ */
+
+#include <cstdint>
+#include <Arduino.h>
+#include <SPI.h>
+#include "Canvas.hpp"
+#include "EpaperDriver.hpp"
+#include "Font.hpp"
+#include "TextConsole.hpp"
+
+using std::uint8_t;
+
+
+static constexpr int MAX_WIDTH  = 264;
+static constexpr int MAX_HEIGHT = 176;
+
+static uint8_t prevImage[MAX_WIDTH * MAX_HEIGHT / 8] = {};
+static EpaperDriver epd(EpaperDriver::Size::EPD_2_71_INCH, prevImage);
+
+static uint8_t image[MAX_WIDTH * MAX_HEIGHT / 8];
+static Canvas canvas(image, epd.getWidth(), epd.getHeight());
+static TextConsole console(canvas, Font::STANDARD);
+
+void setup() {
+	// Configure pins for your microcontroller
+	#if defined(CORE_TEENSY)
+		// PJRC Teensy 3.x
+		epd.panelOnPin = 3;
+		epd.borderControlPin = 1;
+		epd.dischargePin = 2;
+		epd.resetPin = 22;
+		epd.busyPin = 23;
+		epd.chipSelectPin = 0;
+	#elif defined(__MSP432P401R__)
+		// "Texas Instruments SimpleLink MSP-EXP432P401R LaunchPad" (a.k.a. TI MSP432)
+		epd.panelOnPin = 11;
+		epd.borderControlPin = 13;
+		epd.dischargePin = 12;
+		epd.resetPin = 10;
+		epd.busyPin = 8;
+		epd.chipSelectPin = 19;
+	#else
+		#error "Define your pin mapping here"
+	#endif
+	
+	epd.setFrameTime(300);
+	delay(1000);
+	
+	// Start from a clean screen, then only the rows of new text are driven
+	console.clear();
+	console.print("Log started\n");
+	epd.changeImage(image);
+	console.markClean();
+}
+
+
+static int entryNumber = 0;
+
+void loop() {
+	// Append one log line (the screen scrolls once it is full), and refresh only its rows
+	unsigned long seconds = millis() / 1000;
+	console.printf("%02lu:%02lu:%02lu  #%d  A0=%d\n",
+		seconds / 3600, seconds / 60 % 60, seconds % 60, entryNumber, analogRead(0));
+	console.refresh(epd);
+	entryNumber++;
+	delay(2000);
+}
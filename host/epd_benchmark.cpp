@@ -0,0 +1,438 @@
+/* 
+ * Refresh latency and throughput benchmark of the e-paper display hardware driver
+ * 
+ * Runs changeImage() and updateImage() for every panel size against the G2 COG
+ * emulator on a simulated SPI bus, with workloads that exercise the encoder in
+ * different ways, and prints a table of what each refresh cost.
+ * 
+ * Build (from the repository root):
+ *   g++ -std=c++11 -O2 -I host/mock -I src -o epd_benchmark host/epd_benchmark.cpp \
+ *     host/mock/HostHardware.cpp host/mock/G2CogEmulator.cpp src/EpaperDriver.cpp src/CompressedImage.cpp \
+ *     src/EpaperDriverGroup.cpp
+ * (Add -DHOST_SPI_ASYNC to drive the lines through the asynchronous SPI transfer path.)
+ * Usage: ./epd_benchmark [--spi-hz=N] [--call-overhead-ns=N] [--pin-overhead-ns=N] [--frame-time-ms=N] [--poll-dcdc=0|1] [--change-mode=0|1|2]
+ * The change mode option selects ChangeMode FULL (0), SHORTENED (1) or FAST (2).
+ * 
+ * Columns of the output:
+ * - frm/stg: Frames per stage that fit in the frame time budget, averaged over the stages
+ *   drawn. For updates, this is the number of passes over the changed rows.
+ * - B/line: SPI bytes per driven line, including the index and output enable writes.
+ * - CS: Chip select assertions during the whole call.
+ * - encode: Real host CPU time spent in driver code (excluding the mock and emulator),
+ *   as a relative measure of encoding cost. Not representative of a microcontroller.
+ * - bus: Virtual time that bytes occupied the SPI bus.
+ * - power-up, stages, finish: Virtual wall-clock time from the call until the charge pump
+ *   is up, then until the last stage line is latched, then until the call returns.
+ * 
+ * A second table shows the virtual time of a burst of small updates (a moving dot),
+ * each with its own power cycle, and all within one session (beginSession()/endSession()).
+ * 
+ * A third table shows the virtual time of changing the images of several panels on one bus,
+ * one panel at a time with changeImage(), and all at once with EpaperDriverGroup, with frame
+ * repeat counts and with the frame time. The frm/stg column is of the group's refreshes.
+ * 
+ * Copyright (c) Project Nayuki. (MIT License)
+ * https://www.nayuki.io/page/pervasive-displays-epaper-panel-hardware-driver
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * - The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ * - The Software is provided "as is", without warranty of any kind, express or
+ *   implied, including but not limited to the warranties of merchantability,
+ *   fitness for a particular purpose and noninfringement. In no event shall the
+ *   authors or copyright holders be liable for any claim, damages or other
+ *   liability, whether in an action of contract, tort or otherwise, arising from,
+ *   out of or in connection with the Software or the use or other dealings in the
+ *   Software.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "EpaperDriver.hpp"
+#include "EpaperDriverGroup.hpp"
+#include "G2CogEmulator.hpp"
+#include "HostHardware.hpp"
+#include "../example/bitmap_epd/bitmap_demo_0.hpp"
+#include "../example/bitmap_epd/bitmap_demo_1.hpp"
+#include "../example/bitmap_epd/bitmap_demo_2.hpp"
+#include "../example/bitmap_epd/bitmap_demo_3.hpp"
+#include "../example/bitmap_epd/bitmap_demo_4.hpp"
+
+using std::uint8_t;
+using std::uint64_t;
+using std::size_t;
+using std::string;
+using std::vector;
+using Size = EpaperDriver::Size;
+using ChangeMode = EpaperDriver::ChangeMode;
+using Status = EpaperDriver::Status;
+
+
+/*---- Workloads ----*/
+
+static const uint8_t *BITMAPS[] = {IMAGE_0, IMAGE_1, IMAGE_2, IMAGE_3, IMAGE_4};
+static const int SOURCE_WIDTH = 264;
+
+
+struct Panel {
+	const char *name;
+	Size size;
+	int width;
+	int height;
+};
+
+
+struct Workload {
+	string name;
+	bool update;  // updateImage() if true, changeImage() if false
+	short frameRepeats;  // Positive for a repeat count, zero for the frame time budget
+	vector<uint8_t> prev;
+	vector<uint8_t> next;
+};
+
+
+static vector<uint8_t> cropBitmap(int index, const Panel &panel) {
+	vector<uint8_t> result(static_cast<size_t>(panel.width) * panel.height / 8, 0);
+	for (int y = 0; y < panel.height; y++) {
+		for (int x = 0; x < panel.width; x++) {
+			size_t j = static_cast<size_t>(y) * SOURCE_WIDTH + x;
+			size_t i = static_cast<size_t>(y) * panel.width + x;
+			result[i / 8] |= ((BITMAPS[index][j / 8] >> (j % 8)) & 1) << (i % 8);
+		}
+	}
+	return result;
+}
+
+
+static vector<Workload> makeWorkloads(const Panel &panel) {
+	size_t len = static_cast<size_t>(panel.width) * panel.height / 8;
+	int bytesPerLine = panel.width / 8;
+	vector<uint8_t> white(len, 0);
+	vector<Workload> result;
+	
+	vector<uint8_t> checker(len, 0);
+	for (int y = 0; y < panel.height; y++)
+		std::memset(&checker[y * bytesPerLine], y % 2 == 0 ? 0x55 : 0xAA, bytesPerLine);
+	result.push_back(Workload{"checkerboard", false, 0, white, checker});
+	
+	for (int i = 0; i < 5; i++)
+		result.push_back(Workload{"bitmap " + std::to_string(i), false, 0, cropBitmap((i + 4) % 5, panel), cropBitmap(i, panel)});
+	
+	// Three lines of "text" (hatched 8-pixel-tall bands) change, as in a status display
+	vector<uint8_t> text = cropBitmap(0, panel);
+	vector<uint8_t> textChanged = text;
+	for (int band = 0; band < 3; band++) {
+		for (int y = 8 + band * 24; y < 16 + band * 24; y++) {
+			for (int x = 1; x < bytesPerLine / 2; x++)
+				textChanged[y * bytesPerLine + x] ^= static_cast<uint8_t>(0x3C << (y % 2));
+		}
+	}
+	result.push_back(Workload{"sparse text", true, 0, text, textChanged});
+	
+	vector<uint8_t> inverse = cropBitmap(1, panel);
+	for (uint8_t &b : inverse)
+		b = static_cast<uint8_t>(~b);
+	result.push_back(Workload{"full inversion", false, 0, cropBitmap(1, panel), inverse});
+	result.push_back(Workload{"full inversion", true, 0, cropBitmap(1, panel), inverse});
+	
+	// A one-pixel update with one repeat is dominated by the power sequence
+	vector<uint8_t> dot = white;
+	dot[0] = 0x01;
+	result.push_back(Workload{"power cycle", true, 1, white, dot});
+	return result;
+}
+
+
+
+/*---- Measurement ----*/
+
+struct Result {
+	Status status;
+	bool correct;
+	double framesPerStage;
+	double bytesPerLine;
+	uint64_t chipSelects;
+	double encodeMillis;
+	double busMillis;
+	double powerUpMillis;
+	double stagesMillis;
+	double finishMillis;
+};
+
+
+static Result run(const Panel &panel, const Workload &work, short frameTimeMillis, bool pollDcDc, ChangeMode mode) {
+	G2CogEmulator cog(panel.width, panel.height);
+	cog.logWrites = true;
+	cog.setImage(work.prev);
+	HostHardware::device = &cog;
+	HostHardware::reset();
+	
+	vector<uint8_t> prevImage = work.prev;
+	EpaperDriver epd(panel.size, prevImage.data());
+	epd.panelOnPin       = static_cast<signed char>(cog.panelOnPin      );
+	epd.chipSelectPin    = static_cast<signed char>(cog.chipSelectPin   );
+	epd.resetPin         = static_cast<signed char>(cog.resetPin        );
+	epd.busyPin          = static_cast<signed char>(cog.busyPin         );
+	epd.borderControlPin = static_cast<signed char>(cog.borderControlPin);
+	epd.dischargePin     = static_cast<signed char>(cog.dischargePin    );
+	epd.pollDcDc = pollDcDc;
+	epd.setChangeMode(mode);
+	if (work.frameRepeats > 0)
+		epd.setFrameRepeats(work.frameRepeats);
+	else
+		epd.setFrameTime(frameTimeMillis);
+	
+	uint64_t hostStart = HostHardware::hostNanos();
+	Result res;
+	res.status = work.update ? epd.updateImage(work.next.data()) : epd.changeImage(work.next.data());
+	uint64_t hostElapsed = HostHardware::hostNanos() - hostStart;
+	res.encodeMillis = (hostElapsed - HostHardware::hostNanosInMock) / 1e6;
+	res.busMillis = HostHardware::spiBusyNanos / 1e6;
+	res.chipSelects = cog.chipSelects;
+	res.correct = cog.errors.empty();
+	
+	// Find the phase boundaries in the write log: the end of power-up is the output disable
+	// write that follows a good DC/DC check, and the stages end at the output enable of the
+	// last line before the nothing frame (panel height lines) and the final dummy line
+	vector<const G2CogEmulator::RegisterWrite *> enables;
+	const G2CogEmulator::RegisterWrite *poweredUp = nullptr;
+	for (const G2CogEmulator::RegisterWrite &w : cog.writes) {
+		if (w.index == 0x02 && w.data.size() == 1 && w.data[0] == 0x06 && poweredUp == nullptr)
+			poweredUp = &w;
+		else if (w.index == 0x02 && w.data.size() == 1 && w.data[0] == 0x07)
+			enables.push_back(&w);
+	}
+	long stageLines = static_cast<long>(enables.size()) - panel.height - 1;
+	if (poweredUp == nullptr || stageLines <= 0) {
+		res.framesPerStage = res.bytesPerLine = 0;
+		res.powerUpMillis = res.stagesMillis = res.finishMillis = 0;
+		res.correct = false;
+		return res;
+	}
+	const G2CogEmulator::RegisterWrite *stagesEnd = enables.at(static_cast<size_t>(stageLines) - 1);
+	res.powerUpMillis = poweredUp->timeNanos / 1e6;
+	res.stagesMillis = (stagesEnd->timeNanos - poweredUp->timeNanos) / 1e6;
+	res.finishMillis = (HostHardware::nowNanos - stagesEnd->timeNanos) / 1e6;
+	res.bytesPerLine = static_cast<double>(stagesEnd->spiBytes - poweredUp->spiBytes) / stageLines;
+	
+	if (work.update) {
+		int bytesPerLine = panel.width / 8;
+		int changedRows = 0;
+		for (int y = 0; y < panel.height; y++)
+			changedRows += std::memcmp(&work.prev[y * bytesPerLine], &work.next[y * bytesPerLine], bytesPerLine) != 0 ? 1 : 0;
+		res.framesPerStage = static_cast<double>(stageLines) / changedRows;
+	} else {
+		int stages = mode == ChangeMode::FAST ? 2 : 4;
+		res.framesPerStage = static_cast<double>(stageLines) / (stages * panel.height);
+	}
+	res.correct = res.correct && cog.getImage() == work.next;
+	return res;
+}
+
+
+// Draws a dot moving along a diagonal with the given number of updateImage() calls,
+// optionally in one session, and returns the total virtual time in milliseconds,
+// or a negative number if any call failed or the panel doesn't show the final image.
+static double runBurst(const Panel &panel, int updates, bool session, short frameTimeMillis, bool pollDcDc) {
+	G2CogEmulator cog(panel.width, panel.height);
+	HostHardware::device = &cog;
+	HostHardware::reset();
+	
+	vector<uint8_t> prevImage(static_cast<size_t>(panel.width) * panel.height / 8, 0);
+	vector<uint8_t> image = prevImage;
+	EpaperDriver epd(panel.size, prevImage.data());
+	epd.panelOnPin       = static_cast<signed char>(cog.panelOnPin      );
+	epd.chipSelectPin    = static_cast<signed char>(cog.chipSelectPin   );
+	epd.resetPin         = static_cast<signed char>(cog.resetPin        );
+	epd.busyPin          = static_cast<signed char>(cog.busyPin         );
+	epd.borderControlPin = static_cast<signed char>(cog.borderControlPin);
+	epd.dischargePin     = static_cast<signed char>(cog.dischargePin    );
+	epd.pollDcDc = pollDcDc;
+	epd.setFrameTime(frameTimeMillis);
+	
+	bool ok = !session || epd.beginSession() == Status::OK;
+	for (int i = 0; i < updates && ok; i++) {
+		size_t j = static_cast<size_t>(i * 4) * panel.width + i * 4;
+		image[j / 8] ^= static_cast<uint8_t>(1 << (j % 8));
+		ok = epd.updateImage(image.data()) == Status::OK;
+	}
+	ok = ok && (!session || epd.endSession() == Status::OK);
+	ok = ok && cog.errors.empty() && cog.getImage() == image;
+	return ok ? HostHardware::nowNanos / 1e6 : -1;
+}
+
+
+
+// Changes the images of the given number of panels of the given size on one bus, either one after
+// another or all at once with a group, and returns the total virtual time in milliseconds (or a
+// negative number if any refresh failed), and the average frames per stage of the refreshes.
+static double runMulti(const Panel &panel, int panels, bool grouped, short frameRepeats,
+		short frameTimeMillis, bool pollDcDc, double *framesPerStage) {
+	vector<G2CogEmulator> cogs;
+	vector<vector<uint8_t> > prevImages, images;
+	vector<EpaperDriver> drivers;
+	cogs.reserve(static_cast<size_t>(panels));
+	drivers.reserve(static_cast<size_t>(panels));
+	HostDeviceSet bus;
+	for (int i = 0; i < panels; i++) {
+		cogs.emplace_back(panel.width, panel.height);
+		prevImages.push_back(cropBitmap((i + 4) % 5, panel));
+		images.push_back(cropBitmap(i, panel));
+	}
+	for (int i = 0; i < panels; i++) {
+		G2CogEmulator &cog = cogs.at(static_cast<size_t>(i));
+		cog.panelOnPin       = i * 6 + 0;
+		cog.chipSelectPin    = i * 6 + 1;
+		cog.resetPin         = i * 6 + 2;
+		cog.busyPin          = i * 6 + 3;
+		cog.borderControlPin = i * 6 + 4;
+		cog.dischargePin     = i * 6 + 5;
+		cog.sharedBus = true;
+		cog.setImage(prevImages.at(static_cast<size_t>(i)));
+		bus.devices.push_back(&cog);
+		
+		drivers.emplace_back(panel.size, prevImages.at(static_cast<size_t>(i)).data());
+		EpaperDriver &epd = drivers.back();
+		epd.panelOnPin       = static_cast<signed char>(cog.panelOnPin      );
+		epd.chipSelectPin    = static_cast<signed char>(cog.chipSelectPin   );
+		epd.resetPin         = static_cast<signed char>(cog.resetPin        );
+		epd.busyPin          = static_cast<signed char>(cog.busyPin         );
+		epd.borderControlPin = static_cast<signed char>(cog.borderControlPin);
+		epd.dischargePin     = static_cast<signed char>(cog.dischargePin    );
+		epd.pollDcDc = pollDcDc;
+		if (frameRepeats > 0)
+			epd.setFrameRepeats(frameRepeats);
+		else
+			epd.setFrameTime(frameTimeMillis);
+	}
+	HostHardware::device = &bus;
+	HostHardware::reset();
+	
+	bool ok = true;
+	if (grouped) {
+		vector<EpaperDriver*> driverPtrs;
+		vector<const uint8_t*> imagePtrs;
+		for (int i = 0; i < panels; i++) {
+			driverPtrs.push_back(&drivers.at(static_cast<size_t>(i)));
+			imagePtrs.push_back(images.at(static_cast<size_t>(i)).data());
+		}
+		EpaperDriverGroup group(driverPtrs.data(), panels);
+		ok = group.changeImages(imagePtrs.data()) == Status::OK;
+	} else {
+		for (int i = 0; i < panels; i++)
+			ok = ok && drivers.at(static_cast<size_t>(i)).changeImage(images.at(static_cast<size_t>(i)).data()) == Status::OK;
+	}
+	
+	double frames = 0;
+	for (int i = 0; i < panels; i++) {
+		const G2CogEmulator &cog = cogs.at(static_cast<size_t>(i));
+		ok = ok && cog.errors.empty() && cog.getImage() == images.at(static_cast<size_t>(i));
+		frames += static_cast<double>(cog.linesOutput - static_cast<uint64_t>(panel.height)) / (4 * panel.height);
+	}
+	*framesPerStage = frames / panels;
+	HostHardware::device = nullptr;
+	return ok ? HostHardware::nowNanos / 1e6 : -1;
+}
+
+
+
+/*---- Main ----*/
+
+static bool parseOption(const char *arg, const char *name, long *out) {
+	size_t n = std::strlen(name);
+	if (std::strncmp(arg, name, n) != 0 || arg[n] != '=')
+		return false;
+	*out = std::strtol(&arg[n + 1], nullptr, 10);
+	return true;
+}
+
+
+int main(int argc, char *argv[]) {
+	long spiHz = 8000000;
+	long callOverhead = 500;
+	long pinOverhead = 100;
+	long frameTime = 500;
+	long pollDcDc = 0;
+	long changeMode = 0;
+	for (int i = 1; i < argc; i++) {
+		if (!parseOption(argv[i], "--spi-hz", &spiHz)
+				&& !parseOption(argv[i], "--call-overhead-ns", &callOverhead)
+				&& !parseOption(argv[i], "--pin-overhead-ns", &pinOverhead)
+				&& !parseOption(argv[i], "--frame-time-ms", &frameTime)
+				&& !parseOption(argv[i], "--poll-dcdc", &pollDcDc)
+				&& !parseOption(argv[i], "--change-mode", &changeMode)) {
+			std::fprintf(stderr, "Usage: %s [--spi-hz=N] [--call-overhead-ns=N] [--pin-overhead-ns=N] [--frame-time-ms=N] [--poll-dcdc=0|1] [--change-mode=0|1|2]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (spiHz <= 0 || callOverhead < 0 || pinOverhead < 0 || frameTime <= 0 || frameTime > 32767
+			|| changeMode < 0 || changeMode > 2) {
+		std::fprintf(stderr, "Invalid option value\n");
+		return EXIT_FAILURE;
+	}
+	HostHardware::spiClockHz = static_cast<std::uint32_t>(spiHz);
+	HostHardware::spiCallOverheadNanos = static_cast<std::uint32_t>(callOverhead);
+	HostHardware::pinWriteOverheadNanos = static_cast<std::uint32_t>(pinOverhead);
+	HostHardware::measureHostTime = true;
+	static const char *MODE_NAMES[] = {"full", "shortened", "fast"};
+	std::printf("SPI clock %ld Hz, %ld ns per SPI call, %ld ns per pin write, frame time %ld ms, %s DC/DC check, %s change\n\n",
+		spiHz, callOverhead, pinOverhead, frameTime, pollDcDc != 0 ? "polled" : "fixed", MODE_NAMES[changeMode]);
+	
+	static const Panel PANELS[] = {
+		{"1.44\"", Size::EPD_1_44_INCH, 128,  96},
+		{"2.00\"", Size::EPD_2_00_INCH, 200,  96},
+		{"2.71\"", Size::EPD_2_71_INCH, 264, 176},
+	};
+	std::printf("%-6s %-7s %-15s %3s %8s %7s %7s %9s %9s %9s %9s %9s %9s\n",
+		"panel", "call", "workload", "ok", "frm/stg", "B/line", "CS",
+		"encode", "bus", "power-up", "stages", "finish", "total");
+	bool allOk = true;
+	for (const Panel &panel : PANELS) {
+		for (const Workload &work : makeWorkloads(panel)) {
+			Result r = run(panel, work, static_cast<short>(frameTime), pollDcDc != 0,
+				static_cast<ChangeMode>(changeMode));
+			bool ok = r.status == Status::OK && r.correct;
+			allOk = allOk && ok;
+			std::printf("%-6s %-7s %-15s %3s %8.2f %7.1f %7llu %7.2fms %7.1fms %7.1fms %7.1fms %7.1fms %7.1fms\n",
+				panel.name, work.update ? "update" : "change", work.name.c_str(), ok ? "yes" : "NO",
+				r.framesPerStage, r.bytesPerLine, static_cast<unsigned long long>(r.chipSelects),
+				r.encodeMillis, r.busMillis, r.powerUpMillis, r.stagesMillis, r.finishMillis,
+				r.powerUpMillis + r.stagesMillis + r.finishMillis);
+		}
+	}
+	
+	const int BURST_UPDATES = 10;
+	std::printf("\n%-6s %-22s %11s %11s\n", "panel", "burst", "separate", "session");
+	for (const Panel &panel : PANELS) {
+		double separate = runBurst(panel, BURST_UPDATES, false, static_cast<short>(frameTime), pollDcDc != 0);
+		double session  = runBurst(panel, BURST_UPDATES, true , static_cast<short>(frameTime), pollDcDc != 0);
+		allOk = allOk && separate >= 0 && session >= 0;
+		std::printf("%-6s %-22s %9.1fms %9.1fms\n", panel.name,
+			(std::to_string(BURST_UPDATES) + " dot updates").c_str(), separate, session);
+	}
+	
+	const int MULTI_PANELS = 3;
+	const short MULTI_REPEATS = 3;
+	std::printf("\n%-6s %-22s %11s %11s %8s\n", "panel", "multi-panel change", "sequential", "group", "frm/stg");
+	for (const Panel &panel : PANELS) {
+		for (int timed = 0; timed < 2; timed++) {
+			short repeats = timed != 0 ? 0 : MULTI_REPEATS;
+			double frames;
+			double sequential = runMulti(panel, MULTI_PANELS, false, repeats, static_cast<short>(frameTime), pollDcDc != 0, &frames);
+			double group      = runMulti(panel, MULTI_PANELS, true , repeats, static_cast<short>(frameTime), pollDcDc != 0, &frames);
+			allOk = allOk && sequential >= 0 && group >= 0;
+			string name = std::to_string(MULTI_PANELS) + " panels, " + (timed != 0 ? "frame time" : std::to_string(MULTI_REPEATS) + " repeats");
+			std::printf("%-6s %-22s %9.1fms %9.1fms %8.2f\n", panel.name, name.c_str(), sequential, group, frames);
+		}
+	}
+	return allOk ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,471 @@
+/* 
+ * Host-side simulation of the e-paper display hardware driver
+ * 
+ * Runs EpaperDriver::changeImage() with one of the bitmap demo images against
+ * the G2 COG emulator, prints what the emulated panel saw, checks that the panel
+ * ends up showing the image, and writes the panel contents to a PBM file.
+ * Then checks the other drawing paths of the library against the plain-array path
+ * on fresh emulated panels: each must leave the same pixels on the panel and the
+ * same previous image in the driver.
+ * 
+ * Build (from the repository root):
+ *   g++ -std=c++11 -O2 -I host/mock -I src -o epd_sim host/epd_sim.cpp \
+ *     host/mock/HostHardware.cpp host/mock/G2CogEmulator.cpp src/EpaperDriver.cpp src/CompressedImage.cpp \
+ *     src/Canvas.cpp src/Font.cpp src/TextConsole.cpp
+ * Usage: ./epd_sim [1.44|2.00|2.71] [ImageIndex 0-4] [Output.pbm]
+ * 
+ * Copyright (c) Project Nayuki. (MIT License)
+ * https://www.nayuki.io/page/pervasive-displays-epaper-panel-hardware-driver
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * - The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ * - The Software is provided "as is", without warranty of any kind, express or
+ *   implied, including but not limited to the warranties of merchantability,
+ *   fitness for a particular purpose and noninfringement. In no event shall the
+ *   authors or copyright holders be liable for any claim, damages or other
+ *   liability, whether in an action of contract, tort or otherwise, arising from,
+ *   out of or in connection with the Software or the use or other dealings in the
+ *   Software.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include "Canvas.hpp"
+#include "CompressedImage.hpp"
+#include "EpaperDriver.hpp"
+#include "Font.hpp"
+#include "G2CogEmulator.hpp"
+#include "HostHardware.hpp"
+#include "TextConsole.hpp"
+#include "../example/bitmap_epd/bitmap_demo_0.hpp"
+#include "../example/bitmap_epd/bitmap_demo_1.hpp"
+#include "../example/bitmap_epd/bitmap_demo_2.hpp"
+#include "../example/bitmap_epd/bitmap_demo_3.hpp"
+#include "../example/bitmap_epd/bitmap_demo_4.hpp"
+
+using std::uint8_t;
+using std::size_t;
+using std::vector;
+
+
+static const uint8_t *IMAGES[] = {IMAGE_0, IMAGE_1, IMAGE_2, IMAGE_3, IMAGE_4};
+static const int SOURCE_WIDTH = 264;
+
+
+// The panel under simulation.
+struct Panel {
+	EpaperDriver::Size size;
+	int width;
+	int height;
+};
+
+
+// What a drawing path left behind, for comparing paths that should be equivalent.
+struct Outcome {
+	bool ok;  // Every call returned OK, and the emulator saw no protocol error
+	vector<uint8_t> shown;     // Image on the emulated panel
+	vector<uint8_t> previous;  // Previous image saved by the driver
+	std::uint64_t writeHash;   // Of every register write that the emulator saw
+};
+
+
+// Returns the given demo image cropped to the given dimensions.
+static vector<uint8_t> cropImage(int index, int width, int height) {
+	vector<uint8_t> result(static_cast<size_t>(width) * height / 8, 0);
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			size_t j = static_cast<size_t>(y) * SOURCE_WIDTH + x;
+			size_t i = static_cast<size_t>(y) * width + x;
+			result[i / 8] |= ((IMAGES[index][j / 8] >> (j % 8)) & 1) << (i % 8);
+		}
+	}
+	return result;
+}
+
+
+// Assigns the emulator's pins to the given driver, and makes the emulator
+// the device on the host bus with a fresh virtual clock.
+static void connect(EpaperDriver &epd, G2CogEmulator &cog) {
+	HostHardware::device = &cog;
+	HostHardware::reset();
+	epd.panelOnPin       = static_cast<signed char>(cog.panelOnPin      );
+	epd.chipSelectPin    = static_cast<signed char>(cog.chipSelectPin   );
+	epd.resetPin         = static_cast<signed char>(cog.resetPin        );
+	epd.busyPin          = static_cast<signed char>(cog.busyPin         );
+	epd.borderControlPin = static_cast<signed char>(cog.borderControlPin);
+	epd.dischargePin     = static_cast<signed char>(cog.dischargePin    );
+}
+
+
+// Connects the given driver to a new emulated panel, sets the panel and the driver's previous
+// image (previousPixels, or else previousStore) to the given start image, runs the given drawing
+// path (which returns whether all its calls returned OK), and returns what the path left behind.
+static Outcome runPath(EpaperDriver &epd, const Panel &panel, const vector<uint8_t> &start,
+		const std::function<bool (EpaperDriver &)> &path) {
+	G2CogEmulator cog(panel.width, panel.height);
+	connect(epd, cog);
+	epd.setFrameRepeats(2);
+	cog.setImage(start);
+	if (epd.previousPixels != nullptr)
+		std::memcpy(epd.previousPixels, start.data(), start.size());
+	else if (epd.previousStore != nullptr)
+		epd.previousStore->setImage(start.data());
+	
+	Outcome result;
+	result.ok = path(epd);
+	result.ok = result.ok && cog.errors.empty();
+	result.shown = cog.getImage();
+	result.writeHash = cog.writeHash;
+	result.previous.assign(start.size(), 0);
+	if (epd.previousPixels != nullptr)
+		std::memcpy(result.previous.data(), epd.previousPixels, start.size());
+	else if (epd.previousStore != nullptr) {
+		size_t bytesPerLine = static_cast<size_t>(panel.width) / 8;
+		for (int y = 0; y < panel.height; y++)
+			epd.previousStore->getRow(y, &result.previous[y * bytesPerLine]);
+	}
+	HostHardware::device = nullptr;
+	return result;
+}
+
+
+// Prints whether the given path left the same panel contents and previous image
+// as the plain-array path, and returns that.
+static bool reportCheck(const char *name, const Outcome &expected, const Outcome &actual) {
+	bool same = expected.ok && actual.ok
+		&& actual.shown == expected.shown && actual.previous == expected.previous;
+	std::printf("Check %-28s %s\n", (std::string(name) + ":").c_str(), same ? "yes" : "no");
+	return same;
+}
+
+
+// Updates a window at an unaligned position with updateRegion(), versus updateImage()
+// with the whole image patched in the same window.
+static bool checkUpdateRegion(const Panel &panel, const vector<uint8_t> &image0, const vector<uint8_t> &image1) {
+	int x = panel.width / 8 + 3, y = panel.height / 4;
+	int w = panel.width / 2, h = panel.height / 2;
+	size_t bytesPerLine = static_cast<size_t>(panel.width) / 8;
+	size_t windowBytesPerLine = static_cast<size_t>(w + 7) / 8;
+	vector<uint8_t> patched(image0);
+	vector<uint8_t> window(windowBytesPerLine * h, 0);
+	for (int j = 0; j < h; j++) {
+		for (int i = 0; i < w; i++) {
+			size_t k = (y + j) * bytesPerLine * 8 + x + i;
+			int bit = (image1[k / 8] >> (k % 8)) & 1;
+			window[j * windowBytesPerLine + i / 8] |= bit << (i % 8);
+			patched[k / 8] = static_cast<uint8_t>((patched[k / 8] & ~(1 << (k % 8))) | bit << (k % 8));
+		}
+	}
+	
+	vector<uint8_t> prevImage(image0.size());
+	EpaperDriver epd(panel.size, prevImage.data());
+	Outcome expected = runPath(epd, panel, image0, [&](EpaperDriver &d) {
+		return d.updateImage(patched.data()) == EpaperDriver::Status::OK;
+	});
+	Outcome actual = runPath(epd, panel, image0, [&](EpaperDriver &d) {
+		return d.updateRegion(x, y, w, h, window.data()) == EpaperDriver::Status::OK;
+	});
+	return reportCheck("updateRegion()", expected, actual);
+}
+
+
+// Changes and then updates the image with EpaperDriverT<S>, versus EpaperDriver. The specialized
+// line encoders must also send exactly the same bytes, so the register writes are compared too.
+template <EpaperDriver::Size S>
+static bool checkFixedSize(const Panel &panel, const vector<uint8_t> &image0, const vector<uint8_t> &image1) {
+	auto path = [&](EpaperDriver &d) {
+		return d.changeImage(image1.data()) == EpaperDriver::Status::OK
+			&& d.updateImage(image0.data()) == EpaperDriver::Status::OK;
+	};
+	vector<uint8_t> prevImage(image0.size());
+	EpaperDriver plain(S, prevImage.data());
+	Outcome expected = runPath(plain, panel, image0, path);
+	EpaperDriverT<S> fixed(prevImage.data());
+	Outcome actual = runPath(fixed, panel, image0, path);
+	actual.ok = actual.ok && actual.writeHash == expected.writeHash;
+	return reportCheck("EpaperDriverT", expected, actual);
+}
+
+
+static bool checkFixedSize(const Panel &panel, const vector<uint8_t> &image0, const vector<uint8_t> &image1) {
+	switch (panel.size) {
+		case EpaperDriver::Size::EPD_1_44_INCH:
+			return checkFixedSize<EpaperDriver::Size::EPD_1_44_INCH>(panel, image0, image1);
+		case EpaperDriver::Size::EPD_2_00_INCH:
+			return checkFixedSize<EpaperDriver::Size::EPD_2_00_INCH>(panel, image0, image1);
+		case EpaperDriver::Size::EPD_2_71_INCH:
+			return checkFixedSize<EpaperDriver::Size::EPD_2_71_INCH>(panel, image0, image1);
+		default:
+			return false;
+	}
+}
+
+
+// An image array that a row source reads from.
+struct RowSourceImage {
+	const uint8_t *pixels;
+	size_t bytesPerLine;
+};
+
+
+static void copyImageRow(int row, uint8_t pixels[], void *context) {
+	const RowSourceImage *img = static_cast<const RowSourceImage *>(context);
+	std::memcpy(pixels, &img->pixels[row * img->bytesPerLine], img->bytesPerLine);
+}
+
+
+// Changes and then updates the image with row sources, versus the same images in arrays.
+static bool checkRowSource(const Panel &panel, const vector<uint8_t> &image0, const vector<uint8_t> &image1) {
+	size_t bytesPerLine = static_cast<size_t>(panel.width) / 8;
+	RowSourceImage source0 = {image0.data(), bytesPerLine};
+	RowSourceImage source1 = {image1.data(), bytesPerLine};
+	vector<uint8_t> prevImage(image0.size());
+	EpaperDriver epd(panel.size, prevImage.data());
+	Outcome expected = runPath(epd, panel, image0, [&](EpaperDriver &d) {
+		return d.changeImage(image1.data()) == EpaperDriver::Status::OK
+			&& d.updateImage(image0.data()) == EpaperDriver::Status::OK;
+	});
+	Outcome actual = runPath(epd, panel, image0, [&](EpaperDriver &d) {
+		return d.changeImage(copyImageRow, &source1) == EpaperDriver::Status::OK
+			&& d.updateImage(copyImageRow, &source0) == EpaperDriver::Status::OK;
+	});
+	return reportCheck("RowSource", expected, actual);
+}
+
+
+// Changes and then updates the image with the previous image in a CompressedImage,
+// versus the same refreshes with the previous image in an array.
+static bool checkPreviousStore(const Panel &panel, const vector<uint8_t> &image0, const vector<uint8_t> &image1) {
+	auto path = [&](EpaperDriver &d) {
+		return d.changeImage(image1.data()) == EpaperDriver::Status::OK
+			&& d.updateImage(image0.data()) == EpaperDriver::Status::OK;
+	};
+	vector<uint8_t> prevImage(image0.size());
+	EpaperDriver epd(panel.size, prevImage.data());
+	Outcome expected = runPath(epd, panel, image0, path);
+	
+	// Enough for incompressible rows
+	vector<uint8_t> storeBuffer(image0.size() + panel.height * 2);
+	CompressedImage store(storeBuffer.data(), static_cast<int>(storeBuffer.size()), panel.width, panel.height);
+	epd.previousPixels = nullptr;
+	epd.previousStore = &store;
+	Outcome actual = runPath(epd, panel, image0, path);
+	actual.ok = actual.ok && store.isValid();
+	return reportCheck("CompressedImage previous", expected, actual);
+}
+
+
+// Draws shapes, a blit and a clipped blitScaled() with Canvas over one image, versus the same
+// drawing done pixel by pixel into an array, and updates the panel to each result.
+static bool checkCanvas(const Panel &panel, const vector<uint8_t> &image0, const vector<uint8_t> &image1) {
+	int width = panel.width, height = panel.height;
+	auto getBit = [](const uint8_t img[], int stride, int x, int y) {
+		return (img[y * stride + x / 8] >> (x % 8)) & 1;
+	};
+	vector<uint8_t> reference(image0);
+	auto setBit = [&](int x, int y, int bit) {
+		if (0 <= x && x < width && 0 <= y && y < height) {
+			uint8_t &b = reference[y * (width / 8) + x / 8];
+			b = static_cast<uint8_t>((b & ~(1 << (x % 8))) | bit << (x % 8));
+		}
+	};
+	
+	// Cut an icon out of the other image
+	const int iconWidth = 12, iconHeight = 9, iconStride = 2, scale = 3;
+	uint8_t icon[iconStride * iconHeight] = {};
+	for (int y = 0; y < iconHeight; y++) {
+		for (int x = 0; x < iconWidth; x++)
+			icon[y * iconStride + x / 8] |= getBit(image1.data(), width / 8, x + 50, y + 20) << (x % 8);
+	}
+	
+	vector<uint8_t> drawn(image0);
+	Canvas canvas(drawn.data(), width, height);
+	canvas.fillRect(5, 7, width / 3, height / 4, Canvas::Ink::BLACK);
+	canvas.fillRect(width / 4 + 1, height / 5, width / 2, height / 3, Canvas::Ink::INVERT);
+	canvas.drawSpan(3, height - 3, width - 9, Canvas::Ink::WHITE);
+	canvas.drawLine(width - 5, 2, width - 5, height - 2, Canvas::Ink::BLACK);
+	canvas.blit(11, height / 2, image1.data(), width / 8, 37, 9, width / 3, height / 3, Canvas::BlitMode::XOR);
+	canvas.blitScaled(width - 30, height - 20, icon, iconStride, iconWidth, iconHeight, scale, true);
+	
+	for (int y = 7; y < 7 + height / 4; y++) {
+		for (int x = 5; x < 5 + width / 3; x++)
+			setBit(x, y, 1);
+	}
+	for (int y = height / 5; y < height / 5 + height / 3; y++) {
+		for (int x = width / 4 + 1; x < width / 4 + 1 + width / 2; x++)
+			setBit(x, y, getBit(reference.data(), width / 8, x, y) ^ 1);
+	}
+	for (int x = 3; x < width - 6; x++)
+		setBit(x, height - 3, 0);
+	for (int y = 2; y <= height - 2; y++)
+		setBit(width - 5, y, 1);
+	for (int y = 0; y < height / 3; y++) {
+		for (int x = 0; x < width / 3; x++) {
+			int bit = getBit(reference.data(), width / 8, x + 11, y + height / 2);
+			setBit(x + 11, y + height / 2, bit ^ getBit(image1.data(), width / 8, x + 37, y + 9));
+		}
+	}
+	for (int y = 0; y < iconHeight * scale; y++) {
+		for (int x = 0; x < iconWidth * scale; x++) {
+			int bit = x % scale == 0 || y % scale == 0 ? 1 : getBit(icon, iconStride, x / scale, y / scale);
+			setBit(x + width - 30, y + height - 20, bit);
+		}
+	}
+	
+	vector<uint8_t> prevImage(image0.size());
+	EpaperDriver epd(panel.size, prevImage.data());
+	Outcome expected = runPath(epd, panel, image0, [&](EpaperDriver &d) {
+		return d.updateImage(reference.data()) == EpaperDriver::Status::OK;
+	});
+	Outcome actual = runPath(epd, panel, image0, [&](EpaperDriver &d) {
+		return d.updateImage(canvas.getPixels()) == EpaperDriver::Status::OK;
+	});
+	return reportCheck("Canvas", expected, actual);
+}
+
+
+// Writes text over the image with a TextConsole, first a few lines and then enough lines to
+// scroll, and refreshes the panel after each with TextConsole::refresh(), versus updateImage()
+// with the canvas after the same writes.
+static bool checkTextConsole(const Panel &panel, const vector<uint8_t> &image0) {
+	auto writeFirst = [](TextConsole &console) {
+		console.setCursor(2, 1);
+		console.printf("Sensor %d: %d\n", 1, 42);
+		console.print("Tab\tstop\rCR");
+	};
+	auto writeSecond = [](TextConsole &console) {
+		for (int i = 0; i <= console.getLines(); i++)
+			console.printf("\nLine %d", i);
+	};
+	
+	vector<uint8_t> drawn(image0);
+	Canvas canvas(drawn.data(), panel.width, panel.height);
+	TextConsole console(canvas, Font::STANDARD);
+	writeFirst(console);
+	vector<uint8_t> first(drawn);
+	writeSecond(console);
+	vector<uint8_t> second(drawn);
+	
+	vector<uint8_t> prevImage(image0.size());
+	EpaperDriver epd(panel.size, prevImage.data());
+	Outcome expected = runPath(epd, panel, image0, [&](EpaperDriver &d) {
+		return d.updateImage(first.data()) == EpaperDriver::Status::OK
+			&& d.updateImage(second.data()) == EpaperDriver::Status::OK;
+	});
+	drawn = image0;
+	TextConsole refreshed(canvas, Font::STANDARD);
+	Outcome actual = runPath(epd, panel, image0, [&](EpaperDriver &d) {
+		writeFirst(refreshed);
+		bool ok = refreshed.refresh(d) == EpaperDriver::Status::OK;
+		writeSecond(refreshed);
+		return ok && refreshed.refresh(d) == EpaperDriver::Status::OK;
+	});
+	actual.ok = actual.ok && drawn == second;
+	return reportCheck("TextConsole", expected, actual);
+}
+
+
+int main(int argc, char *argv[]) {
+	// Parse arguments
+	std::string sizeName = argc > 1 ? argv[1] : "2.71";
+	int imageIndex = argc > 2 ? std::atoi(argv[2]) : 0;
+	const char *outPath = argc > 3 ? argv[3] : "epd_sim.pbm";
+	EpaperDriver::Size size;
+	int width, height;
+	if (sizeName == "1.44") {
+		size = EpaperDriver::Size::EPD_1_44_INCH;
+		width = 128;
+		height = 96;
+	} else if (sizeName == "2.00") {
+		size = EpaperDriver::Size::EPD_2_00_INCH;
+		width = 200;
+		height = 96;
+	} else if (sizeName == "2.71") {
+		size = EpaperDriver::Size::EPD_2_71_INCH;
+		width = 264;
+		height = 176;
+	} else {
+		std::fprintf(stderr, "Usage: %s [1.44|2.00|2.71] [ImageIndex 0-4] [Output.pbm]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (imageIndex < 0 || imageIndex >= 5) {
+		std::fprintf(stderr, "Invalid image index\n");
+		return EXIT_FAILURE;
+	}
+	
+	// Crop the demo image to the panel
+	vector<uint8_t> image = cropImage(imageIndex, width, height);
+	
+	// Connect the driver to the emulated panel
+	G2CogEmulator cog(width, height);
+	vector<uint8_t> prevImage(image.size(), 0);
+	EpaperDriver epd(size, prevImage.data());
+	connect(epd, cog);
+	EpaperDriver::Statistics stats;
+	epd.statistics = &stats;
+	
+	EpaperDriver::Status st = epd.changeImage(image.data());
+	bool match = cog.getImage() == image;
+	
+	// Report
+	std::printf("Status:            %d\n", static_cast<int>(st));
+	std::printf("Virtual time:      %.1f ms\n", HostHardware::nowNanos / 1e6);
+	std::printf("  of which delay:  %.1f ms\n", HostHardware::delayNanos / 1e6);
+	std::printf("  of which SPI:    %.1f ms\n", HostHardware::spiBusyNanos / 1e6);
+	std::printf("SPI bytes:         %llu\n", static_cast<unsigned long long>(HostHardware::spiBytes));
+	std::printf("Chip selects:      %llu\n", static_cast<unsigned long long>(cog.chipSelects));
+	std::printf("Lines output:      %llu (%.1f frames)\n",
+		static_cast<unsigned long long>(cog.linesOutput), static_cast<double>(cog.linesOutput) / height);
+	std::printf("Dummy lines:       %llu\n", static_cast<unsigned long long>(cog.dummyLines));
+	std::printf("Driver statistics: power on %lu ms (charge pump %lu ms, %d attempts), stages",
+		stats.powerOnTime, stats.chargePumpTime, static_cast<int>(stats.powerAttempts));
+	for (int i = 0; i < 4; i++)
+		std::printf(" %u*%lu ms", static_cast<unsigned int>(stats.stageFrames[i]), stats.stageTime[i]);
+	std::printf(", power off %lu ms, %lu lines, %lu bytes\n", stats.powerOffTime, stats.linesSent, stats.bytesSent);
+	std::printf("Panel shows image: %s\n", match ? "yes" : "no");
+	std::printf("Drive history of pixel (0, 0):");
+	for (const G2CogEmulator::Run &run : cog.getHistory(0, 0)) {
+		const char *name = run.drive == G2CogEmulator::BLACK ? "black" : run.drive == G2CogEmulator::WHITE ? "white" : "nothing";
+		std::printf(" %s*%u", name, static_cast<unsigned int>(run.count));
+	}
+	std::printf("\n");
+	for (const std::string &err : cog.errors)
+		std::printf("Protocol error: %s\n", err.c_str());
+	
+	// Write the panel contents as a plain PBM image
+	std::FILE *f = std::fopen(outPath, "w");
+	if (f == nullptr) {
+		std::perror(outPath);
+		return EXIT_FAILURE;
+	}
+	std::fprintf(f, "P1\n%d %d\n", width, height);
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++)
+			std::fputc(cog.getPixel(x, y) == G2CogEmulator::BLACK ? '1' : '0', f);
+		std::fputc('\n', f);
+	}
+	std::fclose(f);
+	bool passed = st == EpaperDriver::Status::OK && match && cog.errors.empty();
+	
+	// Check the other drawing paths, from this image to the next demo image
+	Panel panel = {size, width, height};
+	vector<uint8_t> nextImage = cropImage((imageIndex + 1) % 5, width, height);
+	passed &= checkUpdateRegion(panel, image, nextImage);
+	passed &= checkFixedSize(panel, image, nextImage);
+	passed &= checkRowSource(panel, image, nextImage);
+	passed &= checkPreviousStore(panel, image, nextImage);
+	passed &= checkCanvas(panel, image, nextImage);
+	passed &= checkTextConsole(panel, image);
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,194 @@
+/* 
+ * Game of Life kernel benchmark for the e-paper display demo program
+ * 
+ * Steps random boards of the sizes that game_of_life_epd.ino uses on the 2.71" panel
+ * (one cell per boardScale * boardScale pixels) with the original per-cell code of the
+ * sketch, and with LifeGrid on 32-bit and 64-bit words. Checks that all of them compute
+ * the same generations, and prints the host CPU time per generation. Then keeps stepping
+ * the 32-bit board for as many generations again, by which time most of the board has
+ * settled, and prints the time per generation of that (which shows the saving of only
+ * recomputing the active tiles) and the period that the board has settled into, if any.
+ * 
+ * Build (from the repository root):
+ *   g++ -std=c++11 -O2 -o life_benchmark host/life_benchmark.cpp
+ * Usage: ./life_benchmark [Generations]
+ * 
+ * Copyright (c) Project Nayuki. (MIT License)
+ * https://www.nayuki.io/page/pervasive-displays-epaper-panel-hardware-driver
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * - The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ * - The Software is provided "as is", without warranty of any kind, express or
+ *   implied, including but not limited to the warranties of merchantability,
+ *   fitness for a particular purpose and noninfringement. In no event shall the
+ *   authors or copyright holders be liable for any claim, damages or other
+ *   liability, whether in an action of contract, tort or otherwise, arising from,
+ *   out of or in connection with the Software or the use or other dealings in the
+ *   Software.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "../example/game_of_life_epd/LifeGrid.hpp"
+
+using std::uint8_t;
+using std::uint32_t;
+using std::uint64_t;
+using std::vector;
+
+
+/*---- Original per-cell code of the sketch ----*/
+
+class BitGrid final {
+	public: uint8_t *data;  // Must have length ceil(width * height / 8), and have all elements initialized.
+	public: int width;      // Must be non-negative.
+	public: int height;     // Must be non-negative.
+	
+	// Returns 0 or 1 if (x, y) is in bounds, otherwise returns 0.
+	public: int getCell(int x, int y) const {
+		if (x < 0 || x >= width || y < 0 || y >= height)
+			return 0;
+		int i = y * width + x;
+		return (data[i >> 3] >> (i & 7)) & 1;
+	}
+	
+	// (x, y) must be in bounds and val must be 0 or 1, otherwise the method does nothing.
+	public: void setCell(int x, int y, int val) {
+		if (x < 0 || x >= width || y < 0 || y >= height || (val != 0 && val != 1))
+			return;
+		int i = y * width + x;
+		data[i >> 3] &= ~(1 << (i & 7));
+		data[i >> 3] |= val << (i & 7);
+	}
+};
+
+
+// As in the sketch, except with fixed-size row arrays instead of variable-length ones.
+static void nextGameOfLifeState(BitGrid &board) {
+	int boardWidth = board.width;
+	int boardHeight = board.height;
+	int rowBytes = (boardWidth + 7) / 8;
+	uint8_t newTopRow [64];
+	uint8_t newPrevRow[64];
+	uint8_t newCurRow [64];
+	
+	for (int y = 0; y < boardHeight; y++) {
+		std::memset(newCurRow, 0, rowBytes);
+		for (int x = 0; x < boardWidth; x++) {
+			int sum = -board.getCell(x, y);
+			for (int dy = -1; dy <= 1; dy++) {
+				for (int dx = -1; dx <= 1; dx++) {
+					int xx = (x + dx + boardWidth ) % boardWidth ;
+					int yy = (y + dy + boardHeight) % boardHeight;
+					sum += board.getCell(xx, yy);
+				}
+			}
+			bool alive = board.getCell(x, y) != 0;
+			newCurRow[x >> 3] |= (sum == 3 || (alive && sum == 2) ? 1 : 0) << (x & 7);
+		}
+		
+		if (y >= 2) {
+			for (int x = 0; x < boardWidth; x++)
+				board.setCell(x, y - 1, (newPrevRow[x >> 3] >> (x & 7)) & 1);
+		}
+		std::memcpy(y == 0 ? newTopRow : newPrevRow, newCurRow, rowBytes);
+	}
+	for (int x = 0; x < boardWidth; x++) {
+		board.setCell(x, 0, (newTopRow[x >> 3] >> (x & 7)) & 1);
+		board.setCell(x, boardHeight - 1, (newPrevRow[x >> 3] >> (x & 7)) & 1);
+	}
+}
+
+
+
+/*---- Benchmark ----*/
+
+static uint64_t hostNanos() {
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+
+// Steps the given board the given number of times, and returns the nanoseconds per generation.
+template <typename Grid>
+static double timeSteps(Grid &grid, int generations) {
+	uint64_t start = hostNanos();
+	for (int i = 0; i < generations; i++)
+		grid.step();
+	return static_cast<double>(hostNanos() - start) / generations;
+}
+
+
+struct OriginalGrid {
+	BitGrid board;
+	void step() {
+		nextGameOfLifeState(board);
+	}
+};
+
+
+template <typename Word>
+static bool sameCells(const BitGrid &a, const LifeGridT<Word> &b) {
+	for (int y = 0; y < a.height; y++) {
+		for (int x = 0; x < a.width; x++) {
+			if (a.getCell(x, y) != b.getCell(x, y))
+				return false;
+		}
+	}
+	return true;
+}
+
+
+int main(int argc, char *argv[]) {
+	int generations = argc >= 2 ? std::atoi(argv[1]) : 200;
+	if (argc > 2 || generations <= 0) {
+		std::fprintf(stderr, "Usage: %s [Generations]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	
+	std::printf("%-6s %-9s %12s %12s %12s %8s %12s %6s %3s\n",
+		"scale", "board", "original", "32-bit", "64-bit", "speedup", "settled", "period", "ok");
+	bool allOk = true;
+	for (int boardScale : {6, 4, 3, 2}) {
+		int width  = (264 - 1 + (boardScale - 1)) / boardScale;
+		int height = (176 - 1 + (boardScale - 1)) / boardScale;
+		vector<uint8_t> bits(static_cast<std::size_t>(width * height + 7) / 8, 0);
+		OriginalGrid original{BitGrid{bits.data(), width, height}};
+		vector<uint32_t> words32(static_cast<std::size_t>(LifeGridT<uint32_t>::getWordCount(width, height)));
+		vector<uint64_t> words64(static_cast<std::size_t>(LifeGridT<uint64_t>::getWordCount(width, height)));
+		LifeGridT<uint32_t> grid32(words32.data(), width, height);
+		LifeGridT<uint64_t> grid64(words64.data(), width, height);
+		
+		std::mt19937 rand(boardScale);
+		for (int y = 0; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				int val = rand() % 100 < 30 ? 1 : 0;
+				original.board.setCell(x, y, val);
+				grid32.setCell(x, y, val);
+				grid64.setCell(x, y, val);
+			}
+		}
+		
+		double originalNanos = timeSteps(original, generations);
+		double nanos32 = timeSteps(grid32, generations);
+		double nanos64 = timeSteps(grid64, generations);
+		bool ok = sameCells(original.board, grid32) && sameCells(original.board, grid64);
+		allOk = allOk && ok;
+		double settledNanos = timeSteps(grid32, generations);
+		std::printf("%-6d %3dx%-5d %10.1fus %10.1fus %10.1fus %7.0fx %10.1fus %6d %3s\n", boardScale, width, height,
+			originalNanos / 1000, nanos32 / 1000, nanos64 / 1000, originalNanos / nanos32,
+			settledNanos / 1000, grid32.getPeriod(), ok ? "yes" : "NO");
+	}
+	return allOk ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,60 @@
+/* 
+ * Host-side stand-in for the Arduino core API
+ * 
+ * Copyright (c) Project Nayuki. (MIT License)
+ * https://www.nayuki.io/page/pervasive-displays-epaper-panel-hardware-driver
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * - The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ * - The Software is provided "as is", without warranty of any kind, express or
+ *   implied, including but not limited to the warranties of merchantability,
+ *   fitness for a particular purpose and noninfringement. In no event shall the
+ *   authors or copyright holders be liable for any claim, damages or other
+ *   liability, whether in an action of contract, tort or otherwise, arising from,
+ *   out of or in connection with the Software or the use or other dealings in the
+ *   Software.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+
+// Only the subset of the Arduino core that the library uses is provided.
+// Time is virtual: it starts at zero and only advances when delay() is called
+// or when the simulated SPI bus is busy (see HostHardware.hpp).
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT  0x0
+#define OUTPUT 0x1
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define CHANGE  1
+#define FALLING 2
+#define RISING  3
+
+void pinMode(std::uint8_t pin, std::uint8_t mode);
+void digitalWrite(std::uint8_t pin, std::uint8_t val);
+int digitalRead(std::uint8_t pin);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+// Interrupt numbers are pin numbers. An attached handler is called when the virtual clock
+// advances past the time that the device changes the pin's level in the given direction.
+int digitalPinToInterrupt(std::uint8_t pin);
+void attachInterrupt(std::uint8_t interrupt, void (*handler)(), int mode);
+void detachInterrupt(std::uint8_t interrupt);
@@ -0,0 +1,348 @@
+/* 
+ * Emulator of the G2 chip-on-glass (COG) driver of Pervasive Displays' e-paper panels
+ * 
+ * Copyright (c) Project Nayuki. (MIT License)
+ * https://www.nayuki.io/page/pervasive-displays-epaper-panel-hardware-driver
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * - The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ * - The Software is provided "as is", without warranty of any kind, express or
+ *   implied, including but not limited to the warranties of merchantability,
+ *   fitness for a particular purpose and noninfringement. In no event shall the
+ *   authors or copyright holders be liable for any claim, damages or other
+ *   liability, whether in an action of contract, tort or otherwise, arising from,
+ *   out of or in connection with the Software or the use or other dealings in the
+ *   Software.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include "Arduino.h"
+#include "G2CogEmulator.hpp"
+
+using std::size_t;
+using std::uint8_t;
+using std::uint64_t;
+using std::vector;
+using Drive = G2CogEmulator::Drive;
+
+
+/*---- Constructor ----*/
+
+G2CogEmulator::G2CogEmulator(int w, int h) :
+		width(w),
+		height(h),
+		borderFirst(w != 128),
+		lastDrive(static_cast<size_t>(w) * h, NOTHING),
+		histories(static_cast<size_t>(w) * h) {
+	if (!((w == 128 && h == 96) || (w == 200 && h == 96) || (w == 264 && h == 176)))
+		throw std::invalid_argument("Unsupported panel size");
+}
+
+
+
+/*---- Inspection methods ----*/
+
+int G2CogEmulator::getWidth() const {
+	return width;
+}
+
+
+int G2CogEmulator::getHeight() const {
+	return height;
+}
+
+
+Drive G2CogEmulator::getPixel(int x, int y) const {
+	return lastDrive.at(static_cast<size_t>(y) * width + x);
+}
+
+
+vector<uint8_t> G2CogEmulator::getImage() const {
+	vector<uint8_t> result(static_cast<size_t>(width) * height / 8, 0);
+	for (size_t i = 0; i < lastDrive.size(); i++) {
+		if (lastDrive[i] == BLACK)
+			result[i / 8] |= 1 << (i % 8);
+	}
+	return result;
+}
+
+
+const vector<G2CogEmulator::Run> &G2CogEmulator::getHistory(int x, int y) const {
+	return histories.at(static_cast<size_t>(y) * width + x);
+}
+
+
+void G2CogEmulator::clearHistory() {
+	for (size_t i = 0; i < lastDrive.size(); i++) {
+		lastDrive[i] = NOTHING;
+		histories[i].clear();
+	}
+}
+
+
+void G2CogEmulator::setImage(const vector<uint8_t> &image) {
+	if (image.size() * 8 != lastDrive.size())
+		throw std::invalid_argument("Image size mismatch");
+	clearHistory();
+	for (size_t i = 0; i < lastDrive.size(); i++)
+		lastDrive[i] = ((image[i / 8] >> (i % 8)) & 1) != 0 ? BLACK : WHITE;
+}
+
+
+void G2CogEmulator::clearStatistics() {
+	chipSelects = 0;
+	registerWrites = 0;
+	registerReads = 0;
+	lineWrites = 0;
+	linesOutput = 0;
+	dummyLines = 0;
+	powerUps = 0;
+	writeHash = UINT64_C(0xCBF29CE484222325);
+	errors.clear();
+	writes.clear();
+}
+
+
+
+/*---- HostDevice methods ----*/
+
+void G2CogEmulator::pinWritten(int pin, int level) {
+	if (pin == panelOnPin) {
+		if (level == HIGH && !powered) {
+			powered = true;
+			powerUps++;
+		} else if (level == LOW && powered)
+			powerDown();
+	} else if (pin == resetPin) {
+		if (level == LOW) {
+			for (uint8_t &reg : registers)
+				reg = 0;
+			pumpOk = false;
+		} else
+			busyUntilNanos = HostHardware::nowNanos + busyAfterResetNanos;
+	} else if (pin == chipSelectPin) {
+		if (level == LOW && !chipSelected) {
+			chipSelected = true;
+			chipSelects++;
+			frameBytes = 0;
+			data.clear();
+		} else if (level == HIGH && chipSelected) {
+			chipSelected = false;
+			commitFrame();
+		}
+	}
+}
+
+
+int G2CogEmulator::pinRead(int pin) {
+	if (pin == busyPin)
+		return powered && HostHardware::nowNanos < busyUntilNanos ? HIGH : LOW;
+	return LOW;
+}
+
+
+uint8_t G2CogEmulator::spiTransfer(uint8_t mosi) {
+	if (sharedBus && (!chipSelected || !powered))
+		return 0x00;
+	if (!HostHardware::spiBegun)
+		error("SPI transfer while SPI is not begun");
+	if (!chipSelected) {
+		error("SPI transfer without chip select");
+		return 0x00;
+	}
+	if (!powered) {
+		error("SPI transfer while panel is off");
+		return 0x00;
+	}
+	int pos = frameBytes;
+	frameBytes++;
+	if (pos == 0) {
+		header = mosi;
+		if (header != 0x70 && header != 0x71 && header != 0x72 && header != 0x73)
+			error("Unknown frame header");
+		return 0x00;
+	}
+	switch (header) {
+		case 0x70:
+			if (pos == 1)
+				index = mosi;
+			else
+				error("Extra byte in index frame");
+			return 0x00;
+		case 0x71:
+			return 0x12;  // G2 COG driver ID
+		case 0x72:
+			data.push_back(mosi);
+			return 0x00;
+		case 0x73:
+			if (pos == 1) {
+				registerReads++;
+				return readRegister(index);
+			}
+			return 0x00;
+		default:
+			return 0x00;
+	}
+}
+
+
+
+/*---- Private helper methods ----*/
+
+void G2CogEmulator::commitFrame() {
+	if (frameBytes == 0)
+		return;
+	if (header == 0x70 && frameBytes != 2)
+		error("Index frame has wrong length");
+	else if (header == 0x72) {
+		if (data.empty())
+			error("Data frame has no data");
+		else
+			writeRegister(index, data);
+	}
+}
+
+
+void G2CogEmulator::writeRegister(uint8_t idx, const vector<uint8_t> &val) {
+	registerWrites++;
+	writeHash = (writeHash ^ idx) * UINT64_C(0x100000001B3);
+	for (uint8_t b : val)
+		writeHash = (writeHash ^ b) * UINT64_C(0x100000001B3);
+	if (logWrites)
+		writes.push_back(RegisterWrite{HostHardware::nowNanos, HostHardware::spiBytes, chipSelects, idx, val});
+	
+	if (idx == 0x01) {
+		channelSelect = val;
+		if (val.size() != 8)
+			error("Channel select has wrong length");
+		return;
+	} else if (idx == 0x0A) {
+		lineWrites++;
+		pendingLine = val;
+		return;
+	}
+	if (val.size() != 1) {
+		error("Register write has wrong length");
+		return;
+	}
+	uint8_t b = val[0];
+	registers[idx] = b;
+	if (idx == 0x02 && b == 0x07)
+		outputLine();
+	else if (idx == 0x05) {
+		uint64_t now = HostHardware::nowNanos;
+		if (b == 0x01)
+			pumpStepNanos[0] = now;
+		else if (b == 0x03)
+			pumpStepNanos[1] = now;
+		else if (b == 0x0F) {
+			pumpStepNanos[2] = now;
+			pumpAttempts++;
+			pumpOk = pumpAttempts > failingPumpAttempts;
+		}
+	}
+}
+
+
+uint8_t G2CogEmulator::readRegister(uint8_t idx) {
+	if (idx != 0x0F)
+		return registers[idx];
+	uint8_t result = 0x80;  // Panel is connected
+	uint64_t now = HostHardware::nowNanos;
+	if (registers[0x05] == 0x0F && pumpOk
+			&& now >= pumpStepNanos[0] + positivePumpNanos
+			&& now >= pumpStepNanos[1] + negativePumpNanos
+			&& now >= pumpStepNanos[2] + vcomPumpNanos)
+		result |= 0x40;  // DC/DC is good
+	return result;
+}
+
+
+void G2CogEmulator::outputLine() {
+	int bytesPerLine = width / 8;
+	int scanBytes = height / 4;
+	size_t expectLen = static_cast<size_t>(1 + bytesPerLine * 2 + scanBytes);
+	if (pendingLine.size() != expectLen) {
+		error("Line data has wrong length");
+		return;
+	}
+	if (registers[0x05] != 0x0F)
+		error("Line output while charge pump is off");
+	if (channelSelect.size() != 8)
+		error("Line output without channel select");
+	
+	const uint8_t *even = &pendingLine[borderFirst ? 1 : 0];
+	const uint8_t *scan = even + bytesPerLine;
+	const uint8_t *odd = scan + scanBytes;
+	
+	// Find the selected row
+	int row = -1;
+	for (int i = 0; i < scanBytes; i++) {
+		uint8_t b = scan[i];
+		if (b == 0)
+			continue;
+		int group = scanBytes - 1 - i;
+		for (int j = 0; j < 4; j++) {
+			int pair = (b >> (j * 2)) & 3;
+			if (pair == 3 && row == -1)
+				row = group * 4 + j;
+			else if (pair != 0) {
+				error("Invalid scan bytes");
+				return;
+			}
+		}
+	}
+	if (row == -1) {
+		dummyLines++;
+		return;
+	}
+	linesOutput++;
+	
+	for (int k = 0; k < bytesPerLine; k++) {
+		int evenX = bytesPerLine - 1 - k;
+		int oddX = k;
+		for (int j = 0; j < 4; j++) {
+			int evenVal = (even[k] >> (j * 2)) & 3;  // Bits 1..0 hold pixel 0, bits 7..6 hold pixel 6
+			int oddVal  = (odd [k] >> (6 - j * 2)) & 3;  // Bits 7..6 hold pixel 1, bits 1..0 hold pixel 7
+			int vals[2] = {evenVal, oddVal};
+			int xs[2] = {evenX * 8 + j * 2, oddX * 8 + j * 2 + 1};
+			for (int m = 0; m < 2; m++) {
+				Drive d = vals[m] >= 2 ? static_cast<Drive>(vals[m]) : NOTHING;
+				size_t pix = static_cast<size_t>(row) * width + xs[m];
+				vector<Run> &hist = histories[pix];
+				if (!hist.empty() && hist.back().drive == d)
+					hist.back().count++;
+				else
+					hist.push_back(Run{d, 1});
+				if (d != NOTHING)
+					lastDrive[pix] = d;
+			}
+		}
+	}
+}
+
+
+void G2CogEmulator::powerDown() {
+	powered = false;
+	for (uint8_t &reg : registers)
+		reg = 0;
+	channelSelect.clear();
+	pendingLine.clear();
+	pumpAttempts = 0;
+	pumpOk = false;
+	if (chipSelected)
+		error("Panel powered off while chip select is low");
+}
+
+
+void G2CogEmulator::error(const std::string &msg) {
+	errors.push_back(msg);
+}
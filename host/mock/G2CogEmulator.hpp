@@ -0,0 +1,201 @@
+/* 
+ * Emulator of the G2 chip-on-glass (COG) driver of Pervasive Displays' e-paper panels
+ * 
+ * Copyright (c) Project Nayuki. (MIT License)
+ * https://www.nayuki.io/page/pervasive-displays-epaper-panel-hardware-driver
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * - The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ * - The Software is provided "as is", without warranty of any kind, express or
+ *   implied, including but not limited to the warranties of merchantability,
+ *   fitness for a particular purpose and noninfringement. In no event shall the
+ *   authors or copyright holders be liable for any claim, damages or other
+ *   liability, whether in an action of contract, tort or otherwise, arising from,
+ *   out of or in connection with the Software or the use or other dealings in the
+ *   Software.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "HostHardware.hpp"
+
+
+/* 
+ * Models one G2 COG driver with its panel, as seen through the pins and SPI bus.
+ * It decodes the register protocol (0x70 index, 0x71 ID, 0x72 data, 0x73 read
+ * framing, each frame delimited by chip select), tracks the charge pump bring-up
+ * that is reported in register 0x0F, and applies every line that is latched by an
+ * output enable write (register 0x02 = 0x07) to a per-pixel drive history.
+ * Deviations from the protocol are recorded as error strings instead of aborting.
+ */
+class G2CogEmulator final : public HostDevice {
+	
+	/*---- Helper types ----*/
+	
+	// The 2-bit value that a line transmission assigns to a pixel.
+	public: enum Drive : std::uint8_t {
+		NOTHING = 0,  // Also the decoding of 0b01
+		WHITE = 2,
+		BLACK = 3,
+	};
+	
+	
+	// A run of consecutive identical drives applied to one pixel.
+	public: struct Run {
+		Drive drive;
+		std::uint32_t count;
+	};
+	
+	
+	// One committed register write, logged when logWrites is true.
+	public: struct RegisterWrite {
+		std::uint64_t timeNanos;  // Virtual time when chip select went high
+		std::uint64_t spiBytes;   // Value of HostHardware::spiBytes at that time
+		std::uint64_t chipSelects;  // Value of chipSelects at that time
+		std::uint8_t index;
+		std::vector<std::uint8_t> data;
+	};
+	
+	
+	
+	/*---- Configuration ----*/
+	
+	// Pin numbers, which must match the ones assigned to the driver under test.
+	public: int panelOnPin       = 0;
+	public: int chipSelectPin    = 1;
+	public: int resetPin         = 2;
+	public: int busyPin          = 3;
+	public: int borderControlPin = 4;
+	public: int dischargePin     = 5;
+	
+	// How long the busy pin stays high after the reset pin rises.
+	public: std::uint64_t busyAfterResetNanos = 1000000;
+	
+	// Minimum settling times of each charge pump step (register 0x05 values 0x01, 0x03, 0x0F),
+	// measured from the write of that step. The DC/DC bit reads as set only after all have elapsed.
+	public: std::uint64_t positivePumpNanos = UINT64_C(100000000);
+	public: std::uint64_t negativePumpNanos = UINT64_C( 60000000);
+	public: std::uint64_t vcomPumpNanos     = UINT64_C( 20000000);
+	
+	// Number of initial power-up attempts (writes of 0x05 = 0x0F) whose DC/DC check fails.
+	public: int failingPumpAttempts = 0;
+	
+	// Whether other devices share the SPI bus, so that transfers while this chip isn't selected
+	// (or is unpowered) are ignored, instead of being recorded as errors.
+	public: bool sharedBus = false;
+	
+	public: bool logWrites = false;
+	
+	
+	
+	/*---- Fields ----*/
+	
+	private: int width;
+	private: int height;
+	private: bool borderFirst;  // Border byte position in a line, which depends on the panel size
+	
+	private: bool powered = false;
+	private: bool chipSelected = false;
+	private: std::uint64_t busyUntilNanos = 0;
+	private: int frameBytes = 0;  // Bytes seen so far in the current chip select frame
+	private: std::uint8_t header = 0;
+	private: std::uint8_t index = 0;
+	private: std::vector<std::uint8_t> data;
+	private: std::uint8_t registers[256] = {};
+	private: std::vector<std::uint8_t> channelSelect;
+	private: std::vector<std::uint8_t> pendingLine;
+	private: std::uint64_t pumpStepNanos[3] = {};
+	private: int pumpAttempts = 0;
+	private: bool pumpOk = false;
+	
+	private: std::vector<Drive> lastDrive;  // Per pixel, the last non-nothing drive
+	private: std::vector<std::vector<Run> > histories;
+	
+	
+	
+	/*---- Statistics ----*/
+	
+	public: std::uint64_t chipSelects = 0;  // Falling edges of chip select
+	public: std::uint64_t registerWrites = 0;
+	public: std::uint64_t registerReads = 0;
+	public: std::uint64_t lineWrites = 0;   // Writes to register 0x0A
+	public: std::uint64_t linesOutput = 0;  // Output enables that drove a row
+	public: std::uint64_t dummyLines = 0;   // Output enables with no row selected
+	public: std::uint64_t powerUps = 0;     // Rising edges of the panel on pin
+	public: std::uint64_t writeHash = UINT64_C(0xCBF29CE484222325);  // FNV-1a over every committed write
+	public: std::vector<std::string> errors;
+	public: std::vector<RegisterWrite> writes;
+	
+	
+	
+	/*---- Constructor ----*/
+	
+	// Creates an emulator for a panel with the given pixel dimensions.
+	// The supported sizes are 128*96 (1.44"), 200*96 (2.00") and 264*176 (2.71").
+	public: G2CogEmulator(int w, int h);
+	
+	
+	
+	/*---- Inspection methods ----*/
+	
+	public: int getWidth() const;
+	
+	public: int getHeight() const;
+	
+	// Returns the color that the pixel was last driven to (WHITE or BLACK),
+	// or NOTHING if it was never driven since the last clearHistory().
+	public: Drive getPixel(int x, int y) const;
+	
+	// Returns the image that the panel shows, in the driver's packed pixel format.
+	// Pixels that were never driven are treated as white.
+	public: std::vector<std::uint8_t> getImage() const;
+	
+	// Returns the run-length encoded sequence of drives applied to the given pixel.
+	public: const std::vector<Run> &getHistory(int x, int y) const;
+	
+	// Clears the drive history and displayed pixels, but not the statistics.
+	public: void clearHistory();
+	
+	// Clears the drive history, and sets the displayed pixels as if the given image
+	// (in the driver's packed pixel format) was drawn before.
+	public: void setImage(const std::vector<std::uint8_t> &image);
+	
+	// Clears the statistics, error list and write log.
+	public: void clearStatistics();
+	
+	
+	
+	/*---- HostDevice methods ----*/
+	
+	public: void pinWritten(int pin, int level) override;
+	
+	public: int pinRead(int pin) override;
+	
+	public: std::uint8_t spiTransfer(std::uint8_t mosi) override;
+	
+	
+	
+	/*---- Private helper methods ----*/
+	
+	private: void commitFrame();
+	
+	private: void writeRegister(std::uint8_t idx, const std::vector<std::uint8_t> &val);
+	
+	private: std::uint8_t readRegister(std::uint8_t idx);
+	
+	private: void outputLine();
+	
+	private: void powerDown();
+	
+	private: void error(const std::string &msg);
+	
+};
@@ -0,0 +1,284 @@
+/* 
+ * Virtual clock, pins and SPI bus for running the driver on a host computer
+ * 
+ * Copyright (c) Project Nayuki. (MIT License)
+ * https://www.nayuki.io/page/pervasive-displays-epaper-panel-hardware-driver
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * - The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ * - The Software is provided "as is", without warranty of any kind, express or
+ *   implied, including but not limited to the warranties of merchantability,
+ *   fitness for a particular purpose and noninfringement. In no event shall the
+ *   authors or copyright holders be liable for any claim, damages or other
+ *   liability, whether in an action of contract, tort or otherwise, arising from,
+ *   out of or in connection with the Software or the use or other dealings in the
+ *   Software.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include "Arduino.h"
+#include "SPI.h"
+#include "HostHardware.hpp"
+
+using std::uint8_t;
+using std::uint32_t;
+using std::uint64_t;
+
+
+/*---- HostHardware ----*/
+
+// Attached interrupts, indexed by pin number.
+struct Interrupt {
+	void (*handler)();
+	int mode;
+	int level;  // Last level seen
+};
+static Interrupt interrupts[64] = {};
+
+
+HostDevice *HostHardware::device = nullptr;
+uint32_t HostHardware::spiClockHz = 8000000;
+uint32_t HostHardware::spiCallOverheadNanos = 0;
+uint32_t HostHardware::pinWriteOverheadNanos = 0;
+bool HostHardware::measureHostTime = false;
+
+uint64_t HostHardware::nowNanos = 0;
+uint64_t HostHardware::spiBusyNanos = 0;
+uint64_t HostHardware::spiBytes = 0;
+uint64_t HostHardware::spiCalls = 0;
+uint64_t HostHardware::pinWrites = 0;
+uint64_t HostHardware::delayNanos = 0;
+uint64_t HostHardware::hostNanosInMock = 0;
+bool HostHardware::spiBegun = false;
+
+
+void HostHardware::reset() {
+	nowNanos = 0;
+	spiBusyNanos = 0;
+	spiBytes = 0;
+	spiCalls = 0;
+	pinWrites = 0;
+	delayNanos = 0;
+	hostNanosInMock = 0;
+	spiBegun = false;
+}
+
+
+void HostHardware::advance(uint64_t nanos) {
+	nowNanos += nanos;
+	if (device == nullptr)
+		return;
+	for (int pin = 0; pin < 64; pin++) {
+		Interrupt &intr = interrupts[pin];
+		if (intr.handler == nullptr)
+			continue;
+		int level = device->pinRead(pin);
+		if (level != intr.level && (intr.mode == CHANGE
+				|| (intr.mode == FALLING && level == LOW) || (intr.mode == RISING && level == HIGH)))
+			intr.handler();
+		intr.level = level;
+	}
+}
+
+
+uint8_t HostHardware::spiByte(uint8_t b) {
+	uint64_t busy = UINT64_C(8000000000) / spiClockHz;
+	advance(busy);
+	spiBusyNanos += busy;
+	spiBytes++;
+	return device != nullptr ? device->spiTransfer(b) : 0x00;
+}
+
+
+uint64_t HostHardware::hostNanos() {
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+
+
+/*---- HostDeviceSet ----*/
+
+void HostDeviceSet::pinWritten(int pin, int level) {
+	for (HostDevice *dev : devices)
+		dev->pinWritten(pin, level);
+}
+
+
+int HostDeviceSet::pinRead(int pin) {
+	int result = LOW;
+	for (HostDevice *dev : devices)
+		result |= dev->pinRead(pin);
+	return result;
+}
+
+
+uint8_t HostDeviceSet::spiTransfer(uint8_t mosi) {
+	uint8_t result = 0x00;
+	for (HostDevice *dev : devices)
+		result |= dev->spiTransfer(mosi);
+	return result;
+}
+
+
+
+/*---- Host time measurement ----*/
+
+// Adds the real time of its lifetime to HostHardware::hostNanosInMock, if enabled.
+class MockTimer final {
+	
+	private: std::uint64_t start;
+	
+	public: MockTimer() :
+		start(HostHardware::measureHostTime ? HostHardware::hostNanos() : 0) {}
+	
+	public: ~MockTimer() {
+		if (HostHardware::measureHostTime)
+			HostHardware::hostNanosInMock += HostHardware::hostNanos() - start;
+	}
+	
+};
+
+
+
+/*---- Arduino core functions ----*/
+
+void pinMode(uint8_t pin, uint8_t mode) {
+	(void)pin;
+	(void)mode;
+}
+
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+	MockTimer timer;
+	HostHardware::advance(HostHardware::pinWriteOverheadNanos);
+	HostHardware::pinWrites++;
+	if (HostHardware::device != nullptr)
+		HostHardware::device->pinWritten(pin, val != LOW ? HIGH : LOW);
+}
+
+
+int digitalRead(uint8_t pin) {
+	MockTimer timer;
+	return HostHardware::device != nullptr ? HostHardware::device->pinRead(pin) : LOW;
+}
+
+
+unsigned long millis() {
+	return static_cast<unsigned long>(HostHardware::nowNanos / 1000000);
+}
+
+
+unsigned long micros() {
+	return static_cast<unsigned long>(HostHardware::nowNanos / 1000);
+}
+
+
+void delay(unsigned long ms) {
+	uint64_t nanos = static_cast<uint64_t>(ms) * 1000000;
+	HostHardware::advance(nanos);
+	HostHardware::delayNanos += nanos;
+}
+
+
+void delayMicroseconds(unsigned int us) {
+	uint64_t nanos = static_cast<uint64_t>(us) * 1000;
+	HostHardware::advance(nanos);
+	HostHardware::delayNanos += nanos;
+}
+
+
+void yield() {}
+
+
+int digitalPinToInterrupt(uint8_t pin) {
+	return pin;
+}
+
+
+void attachInterrupt(uint8_t interrupt, void (*handler)(), int mode) {
+	if (interrupt < 64) {
+		int level = HostHardware::device != nullptr ? HostHardware::device->pinRead(interrupt) : LOW;
+		interrupts[interrupt] = Interrupt{handler, mode, level};
+	}
+}
+
+
+void detachInterrupt(uint8_t interrupt) {
+	if (interrupt < 64)
+		interrupts[interrupt].handler = nullptr;
+}
+
+
+
+/*---- SPI library ----*/
+
+SPIClass SPI;
+
+
+void SPIClass::begin() {
+	HostHardware::spiBegun = true;
+}
+
+
+void SPIClass::end() {
+	HostHardware::spiBegun = false;
+}
+
+
+void SPIClass::setBitOrder(uint8_t order) {
+	(void)order;
+}
+
+
+void SPIClass::setClockDivider(uint8_t div) {
+	(void)div;
+}
+
+
+void SPIClass::setDataMode(uint8_t mode) {
+	(void)mode;
+}
+
+
+uint8_t SPIClass::transfer(uint8_t b) {
+	MockTimer timer;
+	HostHardware::advance(HostHardware::spiCallOverheadNanos);
+	HostHardware::spiCalls++;
+	return HostHardware::spiByte(b);
+}
+
+
+void SPIClass::transfer(void *buf, std::size_t count) {
+	transfer(buf, buf, count);
+}
+
+
+void SPIClass::transfer(const void *txBuf, void *rxBuf, std::size_t count) {
+	MockTimer timer;
+	HostHardware::advance(HostHardware::spiCallOverheadNanos);
+	HostHardware::spiCalls++;
+	const uint8_t *tx = static_cast<const uint8_t *>(txBuf);
+	uint8_t *rx = static_cast<uint8_t *>(rxBuf);
+	for (std::size_t i = 0; i < count; i++) {
+		uint8_t b = HostHardware::spiByte(tx != nullptr ? tx[i] : 0x00);
+		if (rx != nullptr)
+			rx[i] = b;
+	}
+}
+
+
+#if defined(HOST_SPI_ASYNC)
+	bool SPIClass::transfer(const void *txBuf, void *rxBuf, std::size_t count, EventResponderRef event) {
+		transfer(txBuf, rxBuf, count);
+		event.triggerEvent();
+		return true;
+	}
+#endif
@@ -0,0 +1,115 @@
+/* 
+ * Virtual clock, pins and SPI bus for running the driver on a host computer
+ * 
+ * Copyright (c) Project Nayuki. (MIT License)
+ * https://www.nayuki.io/page/pervasive-displays-epaper-panel-hardware-driver
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * - The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ * - The Software is provided "as is", without warranty of any kind, express or
+ *   implied, including but not limited to the warranties of merchantability,
+ *   fitness for a particular purpose and noninfringement. In no event shall the
+ *   authors or copyright holders be liable for any claim, damages or other
+ *   liability, whether in an action of contract, tort or otherwise, arising from,
+ *   out of or in connection with the Software or the use or other dealings in the
+ *   Software.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+
+// Something attached to the simulated microcontroller's pins and SPI bus.
+class HostDevice {
+	
+	public: virtual ~HostDevice() {}
+	
+	// Called after the microcontroller drives the given pin to the given level.
+	public: virtual void pinWritten(int pin, int level) = 0;
+	
+	// Returns the level that the device drives on the given pin.
+	public: virtual int pinRead(int pin) = 0;
+	
+	// Exchanges one byte on the SPI bus, returning the byte on MISO.
+	public: virtual std::uint8_t spiTransfer(std::uint8_t mosi) = 0;
+	
+};
+
+
+
+// Several devices attached to the same pins and SPI bus, each of which must only drive its
+// own pins and ignore the bus while it isn't selected (e.g. G2CogEmulator with sharedBus).
+// Pin and bus activity goes to every device, and the levels that they drive are ORed.
+class HostDeviceSet final : public HostDevice {
+	
+	public: std::vector<HostDevice*> devices;
+	
+	public: void pinWritten(int pin, int level) override;
+	
+	public: int pinRead(int pin) override;
+	
+	public: std::uint8_t spiTransfer(std::uint8_t mosi) override;
+	
+};
+
+
+
+// Global state behind the mock Arduino.h and SPI.h. All times are in nanoseconds of
+// virtual time. Only delays and SPI traffic advance the clock; the CPU is infinitely
+// fast unless a per-call overhead is configured to model the cost of core library calls.
+class HostHardware final {
+	
+	/*---- Configuration ----*/
+	
+	// The device that sees all pin and bus activity. Can be null.
+	public: static HostDevice *device;
+	
+	// SPI clock frequency in hertz. Each byte occupies 8 clock periods on the bus.
+	public: static std::uint32_t spiClockHz;
+	
+	// Virtual time charged for every SPI.transfer() call, single byte or block,
+	// modeling the gap that the core library leaves between calls.
+	public: static std::uint32_t spiCallOverheadNanos;
+	
+	// Virtual time charged for every digitalWrite() call.
+	public: static std::uint32_t pinWriteOverheadNanos;
+	
+	// Whether to measure the real host time spent inside the mock functions (and the device),
+	// so that it can be subtracted from a measurement to get the time spent in the caller's code.
+	public: static bool measureHostTime;
+	
+	
+	/*---- Counters ----*/
+	
+	public: static std::uint64_t nowNanos;
+	public: static std::uint64_t spiBusyNanos;    // Time with bytes on the bus
+	public: static std::uint64_t spiBytes;
+	public: static std::uint64_t spiCalls;
+	public: static std::uint64_t pinWrites;
+	public: static std::uint64_t delayNanos;      // Time spent inside delay() and delayMicroseconds()
+	public: static std::uint64_t hostNanosInMock;  // Real time, if measureHostTime is true
+	public: static bool spiBegun;
+	
+	
+	/*---- Methods ----*/
+	
+	// Resets the clock and all counters, keeping the configuration.
+	public: static void reset();
+	
+	// Advances the virtual clock, then calls the handlers of attached interrupts whose pin changed.
+	public: static void advance(std::uint64_t nanos);
+	
+	public: static std::uint8_t spiByte(std::uint8_t b);
+	
+	// Returns a real monotonic host time in nanoseconds.
+	public: static std::uint64_t hostNanos();
+	
+};
@@ -0,0 +1,97 @@
+/* 
+ * Host-side stand-in for the Arduino SPI library
+ * 
+ * Copyright (c) Project Nayuki. (MIT License)
+ * https://www.nayuki.io/page/pervasive-displays-epaper-panel-hardware-driver
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * - The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ * - The Software is provided "as is", without warranty of any kind, express or
+ *   implied, including but not limited to the warranties of merchantability,
+ *   fitness for a particular purpose and noninfringement. In no event shall the
+ *   authors or copyright holders be liable for any claim, damages or other
+ *   liability, whether in an action of contract, tort or otherwise, arising from,
+ *   out of or in connection with the Software or the use or other dealings in the
+ *   Software.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+#define SPI_CLOCK_DIV2 0x04
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x04
+
+
+// Compiling with HOST_SPI_ASYNC defined adds the asynchronous block transfer of Teensyduino,
+// so that the driver's DMA line pipeline can be exercised on the host.
+#if defined(HOST_SPI_ASYNC)
+	#define SPI_HAS_TRANSFER_ASYNC 1
+	
+	class EventResponder;
+	typedef EventResponder &EventResponderRef;
+	
+	// Like Teensyduino's EventResponder, but only supports immediate (callback) events.
+	class EventResponder final {
+		
+		private: void (*function)(EventResponderRef) = nullptr;
+		
+		public: void attachImmediate(void (*func)(EventResponderRef)) {
+			function = func;
+		}
+		
+		public: void triggerEvent() {
+			if (function != nullptr)
+				function(*this);
+		}
+	
+	};
+#endif
+
+
+// Every byte goes to the device attached to HostHardware, and advances the virtual
+// clock by the bus time of one byte plus the configured per-call software overhead.
+class SPIClass final {
+	
+	public: void begin();
+	
+	public: void end();
+	
+	public: void setBitOrder(std::uint8_t order);
+	
+	public: void setClockDivider(std::uint8_t div);
+	
+	public: void setDataMode(std::uint8_t mode);
+	
+	// Full-duplex single byte transfer, like every Arduino core.
+	public: std::uint8_t transfer(std::uint8_t b);
+	
+	// Block transfer like most Arduino cores: the received bytes overwrite the buffer.
+	// The whole block is charged only one call overhead.
+	public: void transfer(void *buf, std::size_t count);
+	
+	// Block transfer in the style of Teensyduino: sends count bytes from txBuf,
+	// and stores the received bytes into rxBuf unless it is null.
+	// The whole block is charged only one call overhead.
+	public: void transfer(const void *txBuf, void *rxBuf, std::size_t count);
+	
+	#if defined(HOST_SPI_ASYNC)
+		// Asynchronous block transfer in the style of Teensyduino. The bytes are transferred and
+		// the virtual clock advanced at once, then the event is triggered before returning true.
+		public: bool transfer(const void *txBuf, void *rxBuf, std::size_t count, EventResponderRef event);
+	#endif
+	
+};
+
+
+extern SPIClass SPI;
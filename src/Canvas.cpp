@@ -0,0 +1,383 @@
+/* 
+ * Hardware driver for Pervasive Displays' e-paper panels
+ * 
+ * Copyright (c) Project Nayuki. (MIT License)
+ * https://www.nayuki.io/page/pervasive-displays-epaper-panel-hardware-driver
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * - The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ * - The Software is provided "as is", without warranty of any kind, express or
+ *   implied, including but not limited to the warranties of merchantability,
+ *   fitness for a particular purpose and noninfringement. In no event shall the
+ *   authors or copyright holders be liable for any claim, damages or other
+ *   liability, whether in an action of contract, tort or otherwise, arising from,
+ *   out of or in connection with the Software or the use or other dealings in the
+ *   Software.
+ */
+
+#include <cstring>
+#include "Canvas.hpp"
+
+using std::uint8_t;
+using std::uint32_t;
+using std::uint64_t;
+using Ink = Canvas::Ink;
+using BlitMode = Canvas::BlitMode;
+
+
+// Returns the 32 pixels starting at the given byte, with the first pixel in the lowest bit.
+static uint32_t loadWord(const uint8_t data[]) {
+	// Compilers turn this into a single load on little-endian cores with unaligned access
+	return static_cast<uint32_t>(data[0])
+		| static_cast<uint32_t>(data[1]) <<  8
+		| static_cast<uint32_t>(data[2]) << 16
+		| static_cast<uint32_t>(data[3]) << 24;
+}
+
+
+static void storeWord(uint8_t data[], uint32_t word) {
+	data[0] = static_cast<uint8_t>(word >>  0);
+	data[1] = static_cast<uint8_t>(word >>  8);
+	data[2] = static_cast<uint8_t>(word >> 16);
+	data[3] = static_cast<uint8_t>(word >> 24);
+}
+
+
+// Returns the n (in the range [1, 8]) pixels starting at the given bit offset,
+// without reading any byte past the last pixel.
+static unsigned int loadBits(const uint8_t data[], int bit, int n) {
+	int i = bit >> 3;
+	int shift = bit & 7;
+	unsigned int result = data[i] >> shift;
+	if (shift + n > 8)
+		result |= static_cast<unsigned int>(data[i + 1]) << (8 - shift);
+	return result & ((1U << n) - 1);
+}
+
+
+// Returns the destination bits combined with the source bits under the mask.
+template <typename T>
+static T combine(T dst, T src, T mask, BlitMode mode) {
+	switch (mode) {
+		case BlitMode::COPY   :  return static_cast<T>((dst & ~mask) | (src & mask));
+		case BlitMode::OR     :  return static_cast<T>(dst | (src & mask));
+		case BlitMode::AND_NOT:  return static_cast<T>(dst & ~(src & mask));
+		case BlitMode::XOR    :  return static_cast<T>(dst ^ (src & mask));
+		default:  return dst;
+	}
+}
+
+
+
+/*---- Constructor ----*/
+
+Canvas::Canvas(uint8_t buf[], int w, int h) :
+		pixels(buf),
+		width(w),
+		height(h),
+		bytesPerLine(w / 8) {}
+
+
+
+/*---- Methods ----*/
+
+int Canvas::getWidth() const {
+	return width;
+}
+
+
+int Canvas::getHeight() const {
+	return height;
+}
+
+
+int Canvas::getBytesPerLine() const {
+	return bytesPerLine;
+}
+
+
+uint8_t *Canvas::getPixels() const {
+	return pixels;
+}
+
+
+void Canvas::clear() {
+	std::memset(pixels, 0x00, bytesPerLine * height * sizeof(pixels[0]));
+}
+
+
+int Canvas::getPixel(int x, int y) const {
+	if (x < 0 || x >= width || y < 0 || y >= height)
+		return 0;
+	return (pixels[y * bytesPerLine + (x >> 3)] >> (x & 7)) & 1;
+}
+
+
+void Canvas::setPixel(int x, int y, Ink ink) {
+	if (x < 0 || x >= width || y < 0 || y >= height)
+		return;
+	drawMasked(pixels[y * bytesPerLine + (x >> 3)], static_cast<uint8_t>(1 << (x & 7)), ink);
+}
+
+
+void Canvas::drawSpan(int x, int y, int w, Ink ink) {
+	fillRect(x, y, w, 1, ink);
+}
+
+
+void Canvas::fillRect(int x, int y, int w, int h, Ink ink) {
+	// Clip to the image
+	int x0 = x > 0 ? x : 0;
+	int y0 = y > 0 ? y : 0;
+	int x1 = x + w < width  ? x + w : width ;
+	int y1 = y + h < height ? y + h : height;
+	if (x0 >= x1 || y0 >= y1)
+		return;
+	
+	if (x0 == 0 && x1 == width)  // The rows are contiguous
+		drawBytes(&pixels[y0 * bytesPerLine], (y1 - y0) * bytesPerLine, ink);
+	else {
+		for (int i = y0; i < y1; i++)
+			drawRowSpan(&pixels[i * bytesPerLine], x0, x1, ink);
+	}
+}
+
+
+void Canvas::drawLine(int x0, int y0, int x1, int y1, Ink ink) {
+	int dx = x1 > x0 ? x1 - x0 : x0 - x1;
+	int dy = y1 > y0 ? y1 - y0 : y0 - y1;
+	if (dx >= dy) {
+		// Mostly horizontal: step along x, and draw each run of pixels in one row as a span
+		if (x0 > x1) {
+			int tx = x0, ty = y0;
+			x0 = x1;  y0 = y1;
+			x1 = tx;  y1 = ty;
+		}
+		int sy = y0 < y1 ? 1 : -1;
+		int err = dx / 2;
+		int y = y0;
+		int runStart = x0;
+		for (int x = x0; x <= x1; x++) {
+			err -= dy;
+			if (err < 0) {
+				drawSpan(runStart, y, x + 1 - runStart, ink);
+				runStart = x + 1;
+				y += sy;
+				err += dx;
+			}
+		}
+		if (runStart <= x1)
+			drawSpan(runStart, y, x1 + 1 - runStart, ink);
+	} else {
+		// Mostly vertical: step along y, one pixel per row
+		if (y0 > y1) {
+			int tx = x0, ty = y0;
+			x0 = x1;  y0 = y1;
+			x1 = tx;  y1 = ty;
+		}
+		int sx = x0 < x1 ? 1 : -1;
+		int err = dy / 2;
+		int x = x0;
+		for (int y = y0; y <= y1; y++) {
+			setPixel(x, y, ink);
+			err -= dx;
+			if (err < 0) {
+				x += sx;
+				err += dy;
+			}
+		}
+	}
+}
+
+
+void Canvas::blit(int x, int y, const uint8_t src[], int srcStride, int srcX, int srcY,
+		int w, int h, BlitMode mode) {
+	// Clip to this image, moving the source corner along with the destination corner
+	int x0 = x > 0 ? x : 0;
+	int y0 = y > 0 ? y : 0;
+	int x1 = x + w < width  ? x + w : width ;
+	int y1 = y + h < height ? y + h : height;
+	if (x0 >= x1 || y0 >= y1)
+		return;
+	srcX += x0 - x;
+	srcY += y0 - y;
+	for (int i = y0; i < y1; i++)
+		blitRow(&pixels[i * bytesPerLine], x0, x1, &src[(srcY + i - y0) * srcStride], srcX, mode);
+}
+
+
+void Canvas::blitScaled(int x, int y, const uint8_t src[], int srcStride, int srcW, int srcH,
+		int scale, bool grid) {
+	if (scale < 1 || scale > 8)
+		return;
+	int x0 = x > 0 ? x : 0;
+	int y0 = y > 0 ? y : 0;
+	int x1 = x + srcW * scale < width  ? x + srcW * scale : width ;
+	int y1 = y + srcH * scale < height ? y + srcH * scale : height;
+	if (x0 >= x1 || y0 >= y1)
+		return;
+	
+	// Expansion of every group of 4 pixels, with each pixel repeated scale times
+	// (and the first of each repetition set for the grid's vertical lines)
+	uint32_t block = (UINT32_C(1) << scale) - 1;
+	uint32_t table[16];
+	for (int i = 0; i < 16; i++) {
+		uint32_t bits = 0;
+		for (int j = 0; j < 4; j++) {
+			if (((i >> j) & 1) != 0)
+				bits |= block << (j * scale);
+			else if (grid)
+				bits |= UINT32_C(1) << (j * scale);
+		}
+		table[i] = bits;
+	}
+	
+	// Build the first visible row of each source row's blocks, then copy it to the rest
+	for (int sy = (y0 - y) / scale; y + sy * scale < y1; sy++) {
+		int top = y + sy * scale;
+		int bottom = top + scale < y1 ? top + scale : y1;
+		if (top < y0)
+			top = y0;
+		else if (grid) {  // Horizontal grid line
+			drawRowSpan(&pixels[top * bytesPerLine], x0, x1, Ink::BLACK);
+			top++;
+			if (top >= bottom)
+				continue;
+		}
+		uint8_t *row = &pixels[top * bytesPerLine];
+		expandRow(row, x0, x1, &src[sy * srcStride], x0 - x, table, scale * 4);
+		for (int i = top + 1; i < bottom; i++)
+			copyRowSpan(&pixels[i * bytesPerLine], row, x0, x1);
+	}
+}
+
+
+void Canvas::drawRowSpan(uint8_t row[], int x0, int x1, Ink ink) {
+	int first = x0 >> 3;
+	int last = (x1 - 1) >> 3;
+	uint8_t firstMask = static_cast<uint8_t>(0xFF << (x0 & 7));
+	uint8_t lastMask = static_cast<uint8_t>(0xFF >> (7 - ((x1 - 1) & 7)));
+	if (first == last)
+		drawMasked(row[first], firstMask & lastMask, ink);
+	else {
+		drawMasked(row[first], firstMask, ink);
+		drawBytes(&row[first + 1], last - first - 1, ink);
+		drawMasked(row[last], lastMask, ink);
+	}
+}
+
+
+void Canvas::drawMasked(uint8_t &b, uint8_t mask, Ink ink) {
+	switch (ink) {
+		case Ink::WHITE :  b &= static_cast<uint8_t>(~mask);  break;
+		case Ink::BLACK :  b |= mask;  break;
+		case Ink::INVERT:  b ^= mask;  break;
+	}
+}
+
+
+void Canvas::drawBytes(uint8_t data[], int len, Ink ink) {
+	if (ink != Ink::INVERT) {
+		std::memset(data, ink == Ink::BLACK ? 0xFF : 0x00, len * sizeof(data[0]));
+		return;
+	}
+	// The rows aren't word-aligned, so words are loaded and stored with memcpy()
+	int i = 0;
+	for (; i + 4 <= len; i += 4) {
+		uint32_t word;
+		std::memcpy(&word, &data[i], sizeof(word));
+		word = ~word;
+		std::memcpy(&data[i], &word, sizeof(word));
+	}
+	for (; i < len; i++)
+		data[i] = static_cast<uint8_t>(~data[i]);
+}
+
+
+void Canvas::blitRow(uint8_t row[], int x0, int x1, const uint8_t src[], int srcBit, BlitMode mode) {
+	int x = x0;
+	if ((x & 7) != 0) {  // Leading partial byte
+		int shift = x & 7;
+		int n = 8 - shift < x1 - x ? 8 - shift : x1 - x;
+		uint8_t bits = static_cast<uint8_t>(loadBits(src, srcBit, n) << shift);
+		uint8_t mask = static_cast<uint8_t>(((1U << n) - 1) << shift);
+		row[x >> 3] = combine<uint8_t>(row[x >> 3], bits, mask, mode);
+		x += n;
+		srcBit += n;
+	}
+	
+	// Whole words, each made of one or two source words shifted into place
+	for (; x + 32 <= x1; x += 32, srcBit += 32) {
+		const uint8_t *s = &src[srcBit >> 3];
+		int shift = srcBit & 7;
+		uint32_t bits = loadWord(s);
+		if (shift != 0)  // The span continues into a fifth source byte
+			bits = bits >> shift | static_cast<uint32_t>(s[4]) << (32 - shift);
+		uint8_t *d = &row[x >> 3];
+		storeWord(d, combine<uint32_t>(loadWord(d), bits, UINT32_C(0xFFFFFFFF), mode));
+	}
+	
+	// Whole bytes, then the trailing partial byte
+	for (; x < x1; x += 8, srcBit += 8) {
+		int n = x1 - x < 8 ? x1 - x : 8;
+		uint8_t bits = static_cast<uint8_t>(loadBits(src, srcBit, n));
+		row[x >> 3] = combine<uint8_t>(row[x >> 3], bits, static_cast<uint8_t>((1U << n) - 1), mode);
+	}
+}
+
+
+void Canvas::expandRow(uint8_t row[], int x0, int x1, const uint8_t src[], int skip,
+		const uint32_t table[16], int groupBits) {
+	// Bits are accumulated starting at the byte of x0, keeping the pixels before x0
+	uint8_t *out = &row[x0 >> 3];
+	int end = x1 - (x0 & ~7);  // Bits to store starting at out
+	int stored = 0;
+	uint64_t acc = out[0] & ((1U << (x0 & 7)) - 1);
+	int accBits = x0 & 7;
+	int group = skip / groupBits;
+	int drop = skip % groupBits;  // Leading bits of the first group that are clipped off
+	while (true) {
+		unsigned int nibble = (src[group >> 1] >> ((group & 1) * 4)) & 0xF;
+		acc |= static_cast<uint64_t>(table[nibble] >> drop) << accBits;
+		accBits += groupBits - drop;
+		drop = 0;
+		group++;
+		if (stored + accBits >= end)
+			break;
+		if (accBits >= 32) {
+			storeWord(&out[stored >> 3], static_cast<uint32_t>(acc));
+			acc >>= 32;
+			accBits -= 32;
+			stored += 32;
+		}
+	}
+	
+	// Whole bytes, then the trailing partial byte, keeping the pixels after x1
+	for (; stored < end; stored += 8, acc >>= 8) {
+		int n = end - stored < 8 ? end - stored : 8;
+		uint8_t mask = static_cast<uint8_t>((1U << n) - 1);
+		uint8_t &b = out[stored >> 3];
+		b = static_cast<uint8_t>((b & ~mask) | (acc & mask));
+	}
+}
+
+
+void Canvas::copyRowSpan(uint8_t row[], const uint8_t src[], int x0, int x1) {
+	int first = x0 >> 3;
+	int last = (x1 - 1) >> 3;
+	uint8_t firstMask = static_cast<uint8_t>(0xFF << (x0 & 7));
+	uint8_t lastMask = static_cast<uint8_t>(0xFF >> (7 - ((x1 - 1) & 7)));
+	if (first == last)
+		row[first] = combine<uint8_t>(row[first], src[first], firstMask & lastMask, BlitMode::COPY);
+	else {
+		row[first] = combine<uint8_t>(row[first], src[first], firstMask, BlitMode::COPY);
+		std::memcpy(&row[first + 1], &src[first + 1], (last - first - 1) * sizeof(row[0]));
+		row[last] = combine<uint8_t>(row[last], src[last], lastMask, BlitMode::COPY);
+	}
+}
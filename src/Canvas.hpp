@@ -0,0 +1,170 @@
+/* 
+ * Hardware driver for Pervasive Displays' e-paper panels
+ * 
+ * Copyright (c) Project Nayuki. (MIT License)
+ * https://www.nayuki.io/page/pervasive-displays-epaper-panel-hardware-driver
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * - The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ * - The Software is provided "as is", without warranty of any kind, express or
+ *   implied, including but not limited to the warranties of merchantability,
+ *   fitness for a particular purpose and noninfringement. In no event shall the
+ *   authors or copyright holders be liable for any claim, damages or other
+ *   liability, whether in an action of contract, tort or otherwise, arising from,
+ *   out of or in connection with the Software or the use or other dealings in the
+ *   Software.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+
+/* 
+ * Drawing primitives over an image array in the driver's pixel format: one bit per pixel
+ * (1 is black), packed least significant bit first, rows in order with no padding. The
+ * width is a multiple of 8 (as on every panel), so each row starts on a byte boundary.
+ * Spans and rectangles are drawn with byte masks at their ends and whole bytes (or 32-bit
+ * words) in between, so their cost is proportional to the bytes covered, not the pixels.
+ * Coordinates outside the image are clipped, so shapes can be partly or wholly off the image.
+ * 
+ * Sample usage:
+ *   uint8_t image[264 / 8 * 176];
+ *   Canvas canvas(image, 264, 176);
+ *   canvas.clear();
+ *   canvas.fillRect(10, 10, 100, 40, Canvas::Ink::BLACK);
+ *   canvas.drawLine(0, 175, 263, 0, Canvas::Ink::INVERT);
+ *   epd.changeImage(image);
+ */
+class Canvas final {
+	
+	/*---- Helper enums ----*/
+	
+	// What drawing does to each covered pixel.
+	public: enum class Ink : unsigned char {
+		WHITE,   // Clears the bit
+		BLACK,   // Sets the bit
+		INVERT,  // Flips the bit
+	};
+	
+	
+	// How blit() combines each source pixel (1 for black) with the destination pixel.
+	public: enum class BlitMode : unsigned char {
+		COPY,     // Replaces the pixel
+		OR,       // Draws the black source pixels
+		AND_NOT,  // Erases where the source is black
+		XOR,      // Inverts where the source is black
+	};
+	
+	
+	
+	/*---- Fields ----*/
+	
+	private: std::uint8_t *pixels;
+	private: int width;
+	private: int height;
+	private: int bytesPerLine;
+	
+	
+	
+	/*---- Constructor ----*/
+	
+	// Creates a canvas over the given image array with the given dimensions, where the width
+	// is a positive multiple of 8. The array must stay valid while this object is used.
+	// This constructor doesn't modify the array.
+	public: Canvas(std::uint8_t buf[], int w, int h);
+	
+	
+	
+	/*---- Methods ----*/
+	
+	public: int getWidth() const;
+	
+	public: int getHeight() const;
+	
+	public: int getBytesPerLine() const;
+	
+	public: std::uint8_t *getPixels() const;
+	
+	
+	// Sets every pixel to white.
+	public: void clear();
+	
+	
+	// Returns the pixel at (x, y) (1 for black), or 0 if it is outside the image.
+	public: int getPixel(int x, int y) const;
+	
+	
+	// Draws one pixel, if it is inside the image.
+	public: void setPixel(int x, int y, Ink ink);
+	
+	
+	// Draws the horizontal span of w pixels starting at (x, y) and extending to the right.
+	public: void drawSpan(int x, int y, int w, Ink ink);
+	
+	
+	// Draws the rectangle with top left corner (x, y), width w and height h. Ink::INVERT
+	// inverts the rectangle. A rectangle that spans whole rows is drawn as one block of bytes.
+	public: void fillRect(int x, int y, int w, int h, Ink ink);
+	
+	
+	// Draws the line from (x0, y0) to (x1, y1), both inclusive, with Bresenham's algorithm.
+	// Each pixel of the line is drawn once, so Ink::INVERT leaves no gaps. The pixels of
+	// a mostly horizontal line are drawn as spans, one for each row that it crosses.
+	public: void drawLine(int x0, int y0, int x1, int y1, Ink ink);
+	
+	
+	// Combines the w * h rectangle of the source bitmap with top left pixel (srcX, srcY) into this
+	// image with top left pixel (x, y), clipping it to this image. The source has the same format
+	// as this image, except that each row is srcStride bytes and may start at any bit offset, so
+	// srcX needn't be a multiple of 8 (it can e.g. select an icon in a sprite sheet). The source
+	// rectangle must be within the source bitmap, and must not overlap this image's array.
+	// Each row is combined 32 pixels at a time, with masks at its ends.
+	public: void blit(int x, int y, const std::uint8_t src[], int srcStride, int srcX, int srcY,
+		int w, int h, BlitMode mode = BlitMode::COPY);
+	
+	
+	// Draws the srcW * srcH source bitmap (in the format of blit()'s source, with each row starting
+	// at bit 0) enlarged by the given factor in the range [1, 8], so that each source pixel becomes a
+	// scale * scale block with top left pixel (x, y) for the first one, clipped to this image. The
+	// covered pixels are replaced. If grid is true, then the top row and left column of every block
+	// are black, outlining each source pixel. Each output row is built once from a table of expanded
+	// 4-pixel groups, 32 pixels at a time, and then copied to the other rows of the same source row.
+	public: void blitScaled(int x, int y, const std::uint8_t src[], int srcStride, int srcW, int srcH,
+		int scale, bool grid = false);
+	
+	
+	// Draws the pixels [x0, x1) of the given row, which must be within the row.
+	private: static void drawRowSpan(std::uint8_t row[], int x0, int x1, Ink ink);
+	
+	
+	// Draws the pixels selected by the given mask in the given byte.
+	private: static void drawMasked(std::uint8_t &b, std::uint8_t mask, Ink ink);
+	
+	
+	// Draws every pixel of the given bytes.
+	private: static void drawBytes(std::uint8_t data[], int len, Ink ink);
+	
+	
+	// Combines the source pixels starting at the given bit offset of the given source row
+	// into the pixels [x0, x1) of the given row, which must be within the row.
+	private: static void blitRow(std::uint8_t row[], int x0, int x1, const std::uint8_t src[], int srcBit, BlitMode mode);
+	
+	
+	// Replaces the pixels [x0, x1) of the given row, which must be within the row, with the source row
+	// expanded through the given table, starting skip pixels into the expanded row. Each table entry
+	// is the expansion of a group of 4 source pixels, which is groupBits long.
+	private: static void expandRow(std::uint8_t row[], int x0, int x1, const std::uint8_t src[], int skip,
+		const std::uint32_t table[16], int groupBits);
+	
+	
+	// Copies the pixels [x0, x1) of the given source row to the given row, where both are within the rows.
+	private: static void copyRowSpan(std::uint8_t row[], const std::uint8_t src[], int x0, int x1);
+	
+};
@@ -0,0 +1,236 @@
+/* 
+ * Hardware driver for Pervasive Displays' e-paper panels
+ * 
+ * Copyright (c) Project Nayuki. (MIT License)
+ * https://www.nayuki.io/page/pervasive-displays-epaper-panel-hardware-driver
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * - The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ * - The Software is provided "as is", without warranty of any kind, express or
+ *   implied, including but not limited to the warranties of merchantability,
+ *   fitness for a particular purpose and noninfringement. In no event shall the
+ *   authors or copyright holders be liable for any claim, damages or other
+ *   liability, whether in an action of contract, tort or otherwise, arising from,
+ *   out of or in connection with the Software or the use or other dealings in the
+ *   Software.
+ */
+
+#include <cstring>
+#include "CompressedImage.hpp"
+
+using std::uint8_t;
+using std::uint16_t;
+
+
+// Token kinds, in the top 2 bits of a token byte.
+static constexpr uint8_t ZERO_RUN = 0x00;
+static constexpr uint8_t ONE_RUN  = 0x40;
+static constexpr uint8_t LITERAL  = 0x80;
+
+
+
+/*---- Constructor ----*/
+
+CompressedImage::CompressedImage(uint8_t buf[], int cap, int width, int h) :
+		data(buf),
+		capacity(cap),
+		bytesPerLine(width % 8 == 0 ? width / 8 : 0),
+		height(h) {
+	clear();
+}
+
+
+
+/*---- Methods ----*/
+
+int CompressedImage::getBytesPerLine() const {
+	return bytesPerLine;
+}
+
+
+int CompressedImage::getHeight() const {
+	return height;
+}
+
+
+int CompressedImage::getLength() const {
+	return length;
+}
+
+
+bool CompressedImage::isValid() const {
+	return valid;
+}
+
+
+void CompressedImage::clear() {
+	if (!hasValidDimensions()) {
+		valid = false;
+		return;
+	}
+	// Every row is one run of zero bytes
+	std::memset(data, ZERO_RUN | (bytesPerLine - 1), height * sizeof(data[0]));
+	length = height;
+	for (int i = 0; i * 8 < height; i++)
+		groupOffsets[i] = static_cast<uint16_t>(i * 8);
+	cursorRow = 0;
+	cursorOffset = 0;
+	valid = true;
+}
+
+
+bool CompressedImage::setImage(const uint8_t pixels[]) {
+	beginRewrite();
+	for (int y = 0; y < height; y++) {
+		if (!appendRow(&pixels[y * bytesPerLine]))
+			break;
+	}
+	return valid;
+}
+
+
+void CompressedImage::getRow(int y, uint8_t pixels[]) const {
+	if (!valid) {
+		std::memset(pixels, 0x00, bytesPerLine * sizeof(pixels[0]));
+		return;
+	}
+	int i = findRow(y);
+	for (int x = 0; x < bytesPerLine; ) {
+		uint8_t token = data[i];
+		int n = (token & 0x3F) + 1;
+		i++;
+		if ((token & 0xC0) == LITERAL) {
+			std::memcpy(&pixels[x], &data[i], n * sizeof(data[0]));
+			i += n;
+		} else
+			std::memset(&pixels[x], (token & 0xC0) == ONE_RUN ? 0xFF : 0x00, n * sizeof(pixels[0]));
+		x += n;
+	}
+	cursorRow = y + 1;
+	cursorOffset = i;
+}
+
+
+bool CompressedImage::setRow(int y, const uint8_t pixels[]) {
+	if (!valid)
+		return false;
+	uint8_t row[MAX_ROW_BYTES];
+	int newLen = encodeRow(pixels, row);
+	int start = findRow(y);
+	int oldLen = skipRow(start);
+	int delta = newLen - oldLen;
+	if (length + delta > capacity) {
+		valid = false;
+		return false;
+	}
+	
+	// Move the following rows, then fix up the index
+	std::memmove(&data[start + newLen], &data[start + oldLen], (length - start - oldLen) * sizeof(data[0]));
+	std::memcpy(&data[start], row, newLen * sizeof(row[0]));
+	length += delta;
+	for (int i = y / 8 + 1; i * 8 < height; i++)
+		groupOffsets[i] = static_cast<uint16_t>(groupOffsets[i] + delta);
+	cursorRow = y + 1;
+	cursorOffset = start + newLen;
+	return true;
+}
+
+
+void CompressedImage::beginRewrite() {
+	length = 0;
+	cursorRow = 0;
+	cursorOffset = 0;
+	valid = hasValidDimensions();
+}
+
+
+bool CompressedImage::appendRow(const uint8_t pixels[]) {
+	if (!valid || cursorRow >= height)
+		return false;
+	uint8_t row[MAX_ROW_BYTES];
+	int len = encodeRow(pixels, row);
+	if (length + len > capacity) {
+		valid = false;
+		return false;
+	}
+	if (cursorRow % 8 == 0)
+		groupOffsets[cursorRow / 8] = static_cast<uint16_t>(length);
+	std::memcpy(&data[length], row, len * sizeof(row[0]));
+	length += len;
+	cursorRow++;
+	cursorOffset = length;
+	return true;
+}
+
+
+bool CompressedImage::hasValidDimensions() const {
+	return 1 <= bytesPerLine && bytesPerLine <= MAX_ROW_BYTES - 1
+		&& 1 <= height && height <= MAX_HEIGHT && capacity >= height;
+}
+
+
+int CompressedImage::encodeRow(const uint8_t pixels[], uint8_t out[]) const {
+	int len = 0;
+	int literalStart = -1;  // Index in out of the open literal token, or -1 if none
+	for (int x = 0; x < bytesPerLine; ) {
+		// Runs of at least 2 bytes become run tokens, and everything else goes into literals
+		uint8_t b = pixels[x];
+		int n = 1;
+		if (b == 0x00 || b == 0xFF) {
+			while (x + n < bytesPerLine && pixels[x + n] == b)
+				n++;
+		}
+		if (n >= 2) {
+			out[len] = static_cast<uint8_t>((b == 0x00 ? ZERO_RUN : ONE_RUN) | (n - 1));
+			len++;
+			literalStart = -1;
+		} else {
+			if (literalStart == -1) {
+				literalStart = len;
+				out[len] = LITERAL;
+				len++;
+			} else
+				out[literalStart]++;
+			out[len] = b;
+			len++;
+		}
+		x += n;
+	}
+	return len;
+}
+
+
+int CompressedImage::skipRow(int offset) const {
+	int i = offset;
+	for (int x = 0; x < bytesPerLine; ) {
+		uint8_t token = data[i];
+		int n = (token & 0x3F) + 1;
+		i += (token & 0xC0) == LITERAL ? n + 1 : 1;
+		x += n;
+	}
+	return i - offset;
+}
+
+
+int CompressedImage::findRow(int y) const {
+	// Continue from the cursor if it's at or before the row and within its group of 8
+	int row, i;
+	if (cursorRow <= y && cursorRow / 8 == y / 8) {
+		row = cursorRow;
+		i = cursorOffset;
+	} else {
+		row = y / 8 * 8;
+		i = groupOffsets[y / 8];
+	}
+	for (; row < y; row++)
+		i += skipRow(i);
+	cursorRow = y;
+	cursorOffset = i;
+	return i;
+}
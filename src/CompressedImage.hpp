@@ -0,0 +1,144 @@
+/* 
+ * Hardware driver for Pervasive Displays' e-paper panels
+ * 
+ * Copyright (c) Project Nayuki. (MIT License)
+ * https://www.nayuki.io/page/pervasive-displays-epaper-panel-hardware-driver
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * - The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ * - The Software is provided "as is", without warranty of any kind, express or
+ *   implied, including but not limited to the warranties of merchantability,
+ *   fitness for a particular purpose and noninfringement. In no event shall the
+ *   authors or copyright holders be liable for any claim, damages or other
+ *   liability, whether in an action of contract, tort or otherwise, arising from,
+ *   out of or in connection with the Software or the use or other dealings in the
+ *   Software.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+
+/* 
+ * A monochrome image stored in a caller-provided buffer with row-wise run-length
+ * encoding, for use as the previous image of an EpaperDriver (see its field
+ * previousStore) when RAM is too scarce for a full image array. Images that are
+ * mostly white or mostly black (e.g. sparse text) take a small fraction of the
+ * size of an image array: an all-white 2.71" image takes 176 bytes instead of 5808.
+ * 
+ * Each row is encoded separately as a sequence of tokens. A token byte has a 2-bit
+ * kind and a 6-bit count n (meaning n + 1 bytes): kind 0 is a run of 0x00 bytes,
+ * kind 1 is a run of 0xFF bytes, and kind 2 is followed by that many literal bytes.
+ * The start of every eighth row is indexed, so reading a row decodes at most 7 other
+ * rows, and reading rows in increasing order (as the driver does) decodes each row once.
+ * 
+ * Sample usage:
+ *   uint8_t storage[1000];
+ *   CompressedImage prevStore(storage, sizeof(storage), 264, 176);  // Starts all white
+ *   EpaperDriver epd(EpaperDriver::Size::EPD_2_71_INCH);  // No previousPixels
+ *   epd.previousStore = &prevStore;
+ */
+class CompressedImage final {
+	
+	/*---- Fields ----*/
+	
+	// The largest height of any panel, and the number of indexed rows for it.
+	private: static constexpr int MAX_HEIGHT = 176;
+	private: static constexpr int MAX_GROUPS = MAX_HEIGHT / 8;
+	
+	// The largest encoding of one row of up to 33 bytes, which is all literals.
+	public: static constexpr int MAX_ROW_BYTES = 33 + 1;
+	
+	private: std::uint8_t *data;
+	private: int capacity;
+	private: int bytesPerLine;
+	private: int height;
+	private: int length = 0;  // Number of bytes of data in use
+	private: bool valid = true;
+	
+	// groupOffsets[i] is the offset in data where row i * 8 starts.
+	private: std::uint16_t groupOffsets[MAX_GROUPS] = {};
+	
+	// The row that the next sequential read or appendRow() starts at, and its offset in data.
+	private: mutable int cursorRow = 0;
+	private: mutable int cursorOffset = 0;
+	
+	
+	
+	/*---- Constructor ----*/
+	
+	// Creates an all-white image with the given dimensions (width a multiple of 8 in the range
+	// [8, 264], height in the range [1, 176]) in the given buffer, which must stay valid while this
+	// object is used. The capacity must be in the range [height, 65535]; a typical size is a tenth
+	// of an image array. If the dimensions or capacity are out of range, then the buffer is never
+	// written and the image is never valid.
+	public: CompressedImage(std::uint8_t buf[], int cap, int width, int h);
+	
+	
+	
+	/*---- Methods ----*/
+	
+	public: int getBytesPerLine() const;
+	
+	public: int getHeight() const;
+	
+	// Returns the number of bytes of the buffer that the image uses.
+	public: int getLength() const;
+	
+	
+	// Returns false if the buffer ran out of space when the image was last written, in which case
+	// the rows are lost, and drawing methods that need the previous image fail until clear() or
+	// setImage() succeeds. (The screen should then be redrawn with changeImage().)
+	public: bool isValid() const;
+	
+	
+	// Sets every pixel to white, which always fits (given valid dimensions).
+	public: void clear();
+	
+	
+	// Replaces the image with the given image array (in the driver's format), returning isValid().
+	public: bool setImage(const std::uint8_t pixels[]);
+	
+	
+	// Decodes the given row into the given array of getBytesPerLine() bytes.
+	// If the image isn't valid, the row reads as white.
+	public: void getRow(int y, std::uint8_t pixels[]) const;
+	
+	
+	// Replaces the given row with the given getBytesPerLine() bytes, moving the following rows if
+	// its encoded length changes. Returns false if the image isn't valid, or if the row doesn't
+	// fit, in which case the image becomes invalid.
+	public: bool setRow(int y, const std::uint8_t pixels[]);
+	
+	
+	// Rewrites the whole image sequentially: call beginRewrite(), then appendRow() once for each
+	// row from top to bottom. This is faster than setRow() because nothing is moved. If a row
+	// doesn't fit, then appendRow() returns false and the image becomes invalid.
+	public: void beginRewrite();
+	
+	public: bool appendRow(const std::uint8_t pixels[]);
+	
+	
+	// Returns whether the dimensions and capacity given to the constructor are in range.
+	private: bool hasValidDimensions() const;
+	
+	
+	// Encodes the given row into the given array (of at least MAX_ROW_BYTES), returning the length.
+	private: int encodeRow(const std::uint8_t pixels[], std::uint8_t out[]) const;
+	
+	
+	// Returns the number of encoded bytes of the row that starts at the given offset.
+	private: int skipRow(int offset) const;
+	
+	
+	// Returns the offset in data where the given row starts, and moves the cursor to it.
+	private: int findRow(int y) const;
+	
+};
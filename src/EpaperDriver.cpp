@@ -37,40 +37,349 @@ using Status = EpaperDriver::Status;
 #endif
 
 
+#if defined(SPI_HAS_TRANSFER_ASYNC)
+	// Signaled by the SPI library when the DMA transfer of a line write is finished.
+	static EventResponder lineTransferEvent;
+	static volatile bool lineTransferDone = true;
+	
+	static void lineTransferCallback(EventResponderRef) {
+		lineTransferDone = true;
+	}
+#endif
+
+
+
+/*---- Line encoding tables ----*/
+
+// Every byte of a line that is sent to the COG driver is a function of just one
+// byte of input pixels (or two bytes in the case of an update), so the mappings
+// are precomputed at compile time as 256-entry tables indexed by the input byte.
+
+
+// Returns the 2-bit drive value of the pixel at the given bit index of the given byte.
+static constexpr uint8_t mapPixel(int white, int black, int p, int bit) {
+	return static_cast<uint8_t>(((p >> bit) & 1) != 0 ? black : white);
+}
+
+
+// Returns the byte for the even pixels 6, 4, 2, 0 (from most to least significant bit pair).
+static constexpr uint8_t encodeEven(int white, int black, int p) {
+	return static_cast<uint8_t>(
+		mapPixel(white, black, p, 6) << 6 |
+		mapPixel(white, black, p, 4) << 4 |
+		mapPixel(white, black, p, 2) << 2 |
+		mapPixel(white, black, p, 0) << 0);
+}
+
+
+// Returns the byte for the odd pixels 1, 3, 5, 7 (from most to least significant bit pair).
+static constexpr uint8_t encodeOdd(int white, int black, int p) {
+	return static_cast<uint8_t>(
+		mapPixel(white, black, p, 1) << 6 |
+		mapPixel(white, black, p, 3) << 4 |
+		mapPixel(white, black, p, 5) << 2 |
+		mapPixel(white, black, p, 7) << 0);
+}
+
+
+// Returns the given byte with the order of its four bit pairs reversed.
+static constexpr uint8_t reversePairs(int c) {
+	return static_cast<uint8_t>(
+		(c & 0x03) << 6 |
+		(c & 0x0C) << 2 |
+		(c & 0x30) >> 2 |
+		(c & 0xC0) >> 6);
+}
+
+
+// A compile-time list of the integers 0, 1, ..., N - 1, for expanding table initializers.
+template <int... Is> struct Indices {};
+template <int N, int... Is> struct MakeIndices : MakeIndices<N - 1, N - 1, Is...> {};
+template <int... Is> struct MakeIndices<0, Is...> : Indices<Is...> {};
+
+
+struct LineTable {
+	uint8_t even[256];
+	uint8_t odd[256];
+};
+
+
+struct ByteTable {
+	uint8_t values[256];
+};
+
+
+template <int... Is>
+static constexpr LineTable makeLineTable(int white, int black, Indices<Is...>) {
+	return LineTable{{encodeEven(white, black, Is)...}, {encodeOdd(white, black, Is)...}};
+}
+
+
+template <int... Is>
+static constexpr ByteTable makePairReverseTable(Indices<Is...>) {
+	return ByteTable{{reversePairs(Is)...}};
+}
+
+
+// Indexed by EpaperDriver::Stage, excluding NOTHING (whose encoding is always zero).
+static constexpr LineTable STAGE_TABLES[] = {
+	makeLineTable(3, 2, MakeIndices<256>()),  // Compensate
+	makeLineTable(2, 0, MakeIndices<256>()),  // White
+	makeLineTable(3, 0, MakeIndices<256>()),  // Inverse
+	makeLineTable(2, 3, MakeIndices<256>()),  // Normal
+};
+
+
+// For an update, each pixel is sent as the bit pair (changed, new value). For the even pixels,
+// ((old ^ new) & 0x55) << 1 | (new & 0x55) is already the byte to send. For the odd pixels,
+// ((old ^ new) & 0xAA) | (new & 0xAA) >> 1 is looked up in this table to reverse its bit pairs.
+static constexpr ByteTable PAIR_REVERSE_TABLE = makePairReverseTable(MakeIndices<256>());
+
+
+
+/*---- Command lists ----*/
+
+// Fixed sequences of register writes, as (index, data) pairs for spiWriteList().
+
+static const uint8_t POWER_SETTINGS[][2] = {
+	{0x07, 0xD1},  // High power mode osc setting
+	{0x08, 0x02},  // Power setting
+	{0x09, 0xC2},  // Set Vcom level
+	{0x04, 0x03},  // Power setting
+	{0x03, 0x01},  // Driver latch on
+	{0x03, 0x00},  // Driver latch off
+};
+
+
+static const uint8_t CHARGE_PUMP_OFF[][2] = {
+	{0x0B, 0x00},  // Undocumented
+	{0x03, 0x01},  // Latch reset turn on
+	{0x05, 0x03},  // Power off charge pump, Vcom off
+	{0x05, 0x01},  // Power off charge pump negative voltage, VGL & VDL off
+};
+
+
+static const uint8_t DISCHARGE_INTERNAL[][2] = {
+	{0x04, 0x80},  // Discharge internal
+	{0x05, 0x00},  // Power off charge pump positive voltage, VGH & VDH off
+	{0x07, 0x01},  // Turn off osc
+};
+
+
+
+/*---- Pixel helper functions ----*/
+
+// Overwrites the w pixels of the given line starting at column x
+// with the first w pixels of src, leaving all other pixels unchanged.
+static void patchRow(uint8_t line[], int x, int w, const uint8_t src[]) {
+	for (int i = 0; i < w; i += 8) {
+		int n = w - i < 8 ? w - i : 8;
+		unsigned int mask = ((1U << n) - 1) << ((x + i) % 8);
+		unsigned int bits = (static_cast<unsigned int>(src[i / 8]) << ((x + i) % 8)) & mask;
+		uint8_t *p = &line[(x + i) / 8];
+		p[0] = static_cast<uint8_t>((p[0] & ~mask) | bits);
+		if ((mask >> 8) != 0)
+			p[1] = static_cast<uint8_t>((p[1] & ~(mask >> 8)) | (bits >> 8));
+	}
+}
+
+
+
+/*---- Waveform table ----*/
+
+// The vendor's recommended stage times (see setFrameTimeByTemperature()) as a waveform
+// table, where each pair of points at the same temperature makes a step.
+static const EpaperDriver::WaveformPoint DEFAULT_WAVEFORM[] = {
+	{-10, {10710, 10710, 10710, 10710}},  // 630 ms * 17
+	{-10, { 7560,  7560,  7560,  7560}},  // 630 ms * 12
+	{ -5, { 7560,  7560,  7560,  7560}},
+	{ -5, { 5040,  5040,  5040,  5040}},  // 630 ms * 8
+	{  5, { 5040,  5040,  5040,  5040}},
+	{  5, { 2520,  2520,  2520,  2520}},  // 630 ms * 4
+	{ 10, { 2520,  2520,  2520,  2520}},
+	{ 10, { 1890,  1890,  1890,  1890}},  // 630 ms * 3
+	{ 15, { 1890,  1890,  1890,  1890}},
+	{ 15, { 1260,  1260,  1260,  1260}},  // 630 ms * 2
+	{ 20, { 1260,  1260,  1260,  1260}},
+	{ 20, {  630,   630,   630,   630}},  // 630 ms * 1
+	{ 40, {  630,   630,   630,   630}},
+	{ 40, {  441,   441,   441,   441}},  // 630 ms * 0.7
+};
+
+
+
+/*---- Line codecs ----*/
+
+const EpaperDriver::LineCodec EpaperDriver::GENERIC_LINE_CODEC = {
+	Size::INVALID,
+	encodeStageLine<LineLayout>,
+	encodeUpdateLine<LineLayout>,
+};
+
+
+template <Size S> constexpr unsigned char EpaperDriver::FixedLineLayout<S>::bytesPerLine;
+template <Size S> constexpr unsigned char EpaperDriver::FixedLineLayout<S>::scanBytes;
+template <Size S> constexpr unsigned char EpaperDriver::FixedLineLayout<S>::borderIndex;
+template <Size S> constexpr unsigned char EpaperDriver::FixedLineLayout<S>::evenIndex;
+template <Size S> constexpr unsigned char EpaperDriver::FixedLineLayout<S>::scanIndex;
+template <Size S> constexpr unsigned char EpaperDriver::FixedLineLayout<S>::oddIndex;
+template <Size S> constexpr unsigned char EpaperDriver::FixedLineLayout<S>::length;
+
+
+template <Size S>
+const EpaperDriver::LineCodec EpaperDriver::FixedLineLayout<S>::CODEC = {S, stageLine, updateLine};
+
+
+template <Size S>
+int EpaperDriver::FixedLineLayout<S>::stageLine(const LineLayout &, uint8_t buf[], int row,
+		uint8_t border, const uint8_t pixels[], Stage stage) {
+	return encodeStageLine(FixedLineLayout<S>(), buf, row, border, pixels, stage);
+}
+
+
+template <Size S>
+int EpaperDriver::FixedLineLayout<S>::updateLine(const LineLayout &, uint8_t buf[], int row,
+		const uint8_t prevPix[], const uint8_t pixels[]) {
+	return encodeUpdateLine(FixedLineLayout<S>(), buf, row, prevPix, pixels);
+}
+
+
+// Every size's encoders are compiled here, and the linker keeps only those that EpaperDriverT uses.
+template struct EpaperDriver::FixedLineLayout<Size::EPD_1_44_INCH>;
+template struct EpaperDriver::FixedLineLayout<Size::EPD_2_00_INCH>;
+template struct EpaperDriver::FixedLineLayout<Size::EPD_2_71_INCH>;
+
+
 
 /*---- Constructor ----*/
 
+EpaperDriver *EpaperDriver::pendingLineDriver = nullptr;
+EpaperDriver *EpaperDriver::busyInterruptDrivers[BUSY_INTERRUPT_SLOTS] = {};
+unsigned char EpaperDriver::spiUsers = 0;
+
+
 EpaperDriver::EpaperDriver(Size sz, uint8_t prevPix[]) :
-	size(sz),
+	EpaperDriver(sz, prevPix, GENERIC_LINE_CODEC) {}
+
+
+EpaperDriver::EpaperDriver(Size sz, uint8_t prevPix[], const LineCodec &codec) :
 	previousPixels(prevPix),
-	frameRepeat(500) {}
+	size(sz),
+	frameRepeat{500, 500, 500, 500},
+	waveformTable(DEFAULT_WAVEFORM),
+	waveformLength(sizeof(DEFAULT_WAVEFORM) / sizeof(DEFAULT_WAVEFORM[0])),
+	lineCodec(&codec) {}
 
 
 
 /*---- Drawing control methods ----*/
 
 void EpaperDriver::setFrameRepeats(short iters) {
-	if (iters > 0)
-		frameRepeat = -iters;
+	if (iters > 0) {
+		for (short &repeat : frameRepeat)
+			repeat = -iters;
+	}
 }
 
 
 void EpaperDriver::setFrameTime(short millis) {
-	if (millis > 0)
-		frameRepeat = millis;
+	if (millis > 0) {
+		for (short &repeat : frameRepeat)
+			repeat = millis;
+	}
 }
 
 
 void EpaperDriver::setFrameTimeByTemperature(int tmpr) {
-	frameRepeat = 630;
-	if      (tmpr <= -10)  frameRepeat *= 17;
-	else if (tmpr <= - 5)  frameRepeat *= 12;
-	else if (tmpr <=   5)  frameRepeat *=  8;
-	else if (tmpr <=  10)  frameRepeat *=  4;
-	else if (tmpr <=  15)  frameRepeat *=  3;
-	else if (tmpr <=  20)  frameRepeat *=  2;
-	else if (tmpr <=  40)  frameRepeat *=  1;
-	else  frameRepeat = frameRepeat * 7 / 10;
+	short time = 630;
+	if      (tmpr <= -10)  time *= 17;
+	else if (tmpr <= - 5)  time *= 12;
+	else if (tmpr <=   5)  time *=  8;
+	else if (tmpr <=  10)  time *=  4;
+	else if (tmpr <=  15)  time *=  3;
+	else if (tmpr <=  20)  time *=  2;
+	else if (tmpr <=  40)  time *=  1;
+	else  time = time * 7 / 10;
+	setFrameTime(time);
+}
+
+
+void EpaperDriver::setChangeMode(ChangeMode mode) {
+	changeMode = mode;
+}
+
+
+void EpaperDriver::setStageTimes(const unsigned short times[4]) {
+	for (int i = 0; i < 4; i++) {
+		if (times[i] == 0 || times[i] > 32767)
+			return;
+	}
+	for (int i = 0; i < 4; i++)
+		frameRepeat[i] = static_cast<short>(times[i]);
+}
+
+
+bool EpaperDriver::getStageTimes(unsigned short times[4]) const {
+	if (frameRepeat[0] < 0)
+		return false;
+	for (int i = 0; i < 4; i++)
+		times[i] = static_cast<unsigned short>(frameRepeat[i]);
+	return true;
+}
+
+
+void EpaperDriver::setStageRepeats(const unsigned short repeats[4]) {
+	for (int i = 0; i < 4; i++) {
+		if (repeats[i] == 0 || repeats[i] > 32767)
+			return;
+	}
+	for (int i = 0; i < 4; i++)
+		frameRepeat[i] = static_cast<short>(-repeats[i]);
+}
+
+
+bool EpaperDriver::getStageRepeats(unsigned short repeats[4]) const {
+	if (frameRepeat[0] > 0)
+		return false;
+	for (int i = 0; i < 4; i++)
+		repeats[i] = static_cast<unsigned short>(-frameRepeat[i]);
+	return true;
+}
+
+
+void EpaperDriver::setWaveformTable(const WaveformPoint table[], int count) {
+	if (table == nullptr || count <= 0 || count > 255) {
+		table = DEFAULT_WAVEFORM;
+		count = sizeof(DEFAULT_WAVEFORM) / sizeof(DEFAULT_WAVEFORM[0]);
+	}
+	waveformTable = table;
+	waveformLength = static_cast<unsigned char>(count);
+}
+
+
+void EpaperDriver::setWaveformByTemperature(int tmpr) {
+	// Find the last point below the temperature, and interpolate towards the next point
+	const WaveformPoint *table = waveformTable;
+	int n = waveformLength;
+	int i = -1;
+	while (i + 1 < n && table[i + 1].temperature < tmpr)
+		i++;
+	unsigned short times[4];
+	if (i == -1)  // At or below the first point
+		std::memcpy(times, table[0].stageTime, sizeof(times));
+	else if (i == n - 1)  // Above the last point
+		std::memcpy(times, table[n - 1].stageTime, sizeof(times));
+	else {
+		const WaveformPoint &lo = table[i];
+		const WaveformPoint &hi = table[i + 1];
+		long span = hi.temperature - lo.temperature;  // Positive because lo is below tmpr
+		long pos = tmpr - lo.temperature;
+		for (int j = 0; j < 4; j++) {
+			long diff = static_cast<long>(hi.stageTime[j]) - lo.stageTime[j];
+			times[j] = static_cast<unsigned short>(lo.stageTime[j] + diff * pos / span);
+		}
+	}
+	setStageTimes(times);
 }
 
 
@@ -78,199 +387,584 @@ void EpaperDriver::setFrameTimeByTemperature(int tmpr) {
 /*---- Drawing methods ----*/
 
 Status EpaperDriver::changeImage(const uint8_t pixels[], const uint8_t prevPix[]) {
+	return finishRefresh(beginChange(pixels, prevPix));
+}
+
+
+Status EpaperDriver::updateImage(const uint8_t pixels[], const uint8_t prevPix[]) {
+	return finishRefresh(beginUpdate(pixels, prevPix));
+}
+
+
+Status EpaperDriver::updateRegion(int x, int y, int w, int h, const uint8_t pixels[]) {
+	return finishRefresh(beginUpdateRegion(x, y, w, h, pixels));
+}
+
+
+Status EpaperDriver::changeImage(RowSource source, void *context, const uint8_t prevPix[]) {
+	return finishRefresh(beginChange(source, context, prevPix));
+}
+
+
+Status EpaperDriver::updateImage(RowSource source, void *context, const uint8_t prevPix[]) {
+	return finishRefresh(beginUpdate(source, context, prevPix));
+}
+
+
+int EpaperDriver::findChangedRows() {
+	int bytesPerLine = getBytesPerLine();
+	int height = getHeight();
+	std::memset(changedRows, 0, (height + 7) / 8 * sizeof(changedRows[0]));
+	int count = 0;
+	for (int y = 0; y < height; y++) {
+		uint8_t prevLine[MAX_LINE_BYTES];
+		uint8_t line[MAX_LINE_BYTES];
+		const uint8_t *a = getSourceRow(y, prevLine);
+		const uint8_t *b = getTargetRow(y, line);
+		
+		// Compare a word at a time (memcpy because rows needn't be aligned), then the tail bytes
+		uint32_t diff = 0;
+		int x = 0;
+		for (; x + 4 <= bytesPerLine && diff == 0; x += 4) {
+			uint32_t u, v;
+			std::memcpy(&u, &a[x], sizeof(u));
+			std::memcpy(&v, &b[x], sizeof(v));
+			diff = u ^ v;
+		}
+		for (; x < bytesPerLine && diff == 0; x++)
+			diff = a[x] ^ b[x];
+		
+		if (diff != 0) {
+			changedRows[y / 8] |= 1 << (y % 8);
+			count++;
+		}
+	}
+	return count;
+}
+
+
+const uint8_t *EpaperDriver::getTargetRow(int y, uint8_t buf[]) const {
+	if (rowSource == nullptr)
+		return &targetPixels[y * getBytesPerLine()];
+	rowSource(y, buf, rowContext);
+	return buf;
+}
+
+
+void EpaperDriver::saveTargetImage() {
+	int bytesPerLine = getBytesPerLine();
+	CompressedImage *store = getPreviousStore();
+	if (previousPixels != nullptr && rowSource == nullptr)
+		std::memcpy(previousPixels, targetPixels, bytesPerLine * getHeight() * sizeof(targetPixels[0]));
+	else if (previousPixels != nullptr) {
+		for (int y = 0, height = getHeight(); y < height; y++)
+			rowSource(y, &previousPixels[y * bytesPerLine], rowContext);
+	} else if (store != nullptr) {
+		store->beginRewrite();
+		for (int y = 0, height = getHeight(); y < height; y++) {
+			uint8_t line[MAX_LINE_BYTES];
+			store->appendRow(getTargetRow(y, line));
+		}
+	}
+}
+
+
+const uint8_t *EpaperDriver::getSourceRow(int y, uint8_t buf[]) const {
+	if (sourcePixels != nullptr)
+		return &sourcePixels[y * getBytesPerLine()];
+	previousStore->getRow(y, buf);
+	return buf;
+}
+
+
+CompressedImage *EpaperDriver::getPreviousStore() const {
+	if (previousPixels != nullptr || previousStore == nullptr
+			|| previousStore->getBytesPerLine() != getBytesPerLine() || previousStore->getHeight() != getHeight())
+		return nullptr;
+	return previousStore;
+}
+
+
+bool EpaperDriver::hasPreviousImage(const uint8_t prevPix[]) const {
+	if (prevPix != nullptr)
+		return true;
+	CompressedImage *store = getPreviousStore();
+	return store != nullptr && store->isValid();
+}
+
+
+int EpaperDriver::nextChangedRow(int start) const {
+	for (int y = start, height = getHeight(); y < height; y++) {
+		if (changedRows[y / 8] == 0)
+			y |= 7;  // Skip the rest of this group of 8 unchanged rows
+		else if (((changedRows[y / 8] >> (y % 8)) & 1) != 0)
+			return y;
+	}
+	return -1;
+}
+
+
+void EpaperDriver::recordStage(int index, int frames, unsigned long startTime) {
+	if (statistics != nullptr) {
+		statistics->stageFrames[index] = static_cast<unsigned short>(frames);
+		statistics->stageTime[index] = millis() - startTime;
+	}
+}
+
+
+void EpaperDriver::drawLine(int y, const uint8_t pixels[], Stage stage, uint8_t border) {
+	uint8_t *buf = lineBuffers[lineBufferIndex];
+	sendLine(buf, lineCodec->stageLine(lineLayout, buf, y, border, pixels, stage));
+}
+
+
+void EpaperDriver::updateLine(int y, const uint8_t prevPix[], const uint8_t pixels[]) {
+	uint8_t *buf = lineBuffers[lineBufferIndex];
+	sendLine(buf, lineCodec->updateLine(lineLayout, buf, y, prevPix, pixels));
+}
+
+
+template <typename Layout>
+void EpaperDriver::encodeLineFrame(const Layout &layout, uint8_t buf[], int row, uint8_t border) {
+	buf[0] = 0x72;  // Data header
+	buf[layout.borderIndex] = border;
+	
+	// The scan bytes are all zero except for the one byte (counting from the bottom group
+	// of 4 rows to the top) that selects the row; the dummy line (row = -4) selects no row
+	uint8_t *scan = &buf[layout.scanIndex];
+	std::memset(scan, 0x00, layout.scanBytes * sizeof(scan[0]));
+	if (row >= 0)
+		scan[layout.scanBytes - 1 - row / 4] = static_cast<uint8_t>(3 << (row % 4 * 2));
+}
+
+
+template <typename Layout>
+int EpaperDriver::encodeStageLine(const Layout &layout, uint8_t buf[], int row,
+		uint8_t border, const uint8_t pixels[], Stage stage) {
+	encodeLineFrame(layout, buf, row, border);
+	uint8_t *even = &buf[layout.evenIndex];
+	uint8_t *odd  = &buf[layout.oddIndex ];
+	int bytesPerLine = layout.bytesPerLine;
+	if (stage != Stage::NOTHING) {
+		const LineTable &table = STAGE_TABLES[static_cast<int>(stage)];
+		for (int x = 0; x < bytesPerLine; x++) {
+			uint8_t p = pixels[x];
+			even[bytesPerLine - 1 - x] = table.even[p];
+			odd[x] = table.odd[p];
+		}
+	} else {
+		std::memset(even, 0x00, bytesPerLine * sizeof(even[0]));
+		std::memset(odd , 0x00, bytesPerLine * sizeof(odd [0]));
+	}
+	return layout.length;
+}
+
+
+template <typename Layout>
+int EpaperDriver::encodeUpdateLine(const Layout &layout, uint8_t buf[], int row,
+		const uint8_t prevPix[], const uint8_t pixels[]) {
+	encodeLineFrame(layout, buf, row, 0x00);
+	uint8_t *even = &buf[layout.evenIndex];
+	uint8_t *odd  = &buf[layout.oddIndex ];
+	for (int x = 0, bytesPerLine = layout.bytesPerLine; x < bytesPerLine; x++) {
+		uint8_t a = prevPix[x];
+		uint8_t b = pixels[x];
+		even[bytesPerLine - 1 - x] = static_cast<uint8_t>(((a ^ b) & 0x55) << 1 | (b & 0x55));
+		odd[x] = PAIR_REVERSE_TABLE.values[((a ^ b) & 0xAA) | (b & 0xAA) >> 1];
+	}
+	return layout.length;
+}
+
+
+void EpaperDriver::sendLine(uint8_t buf[], int len) {
+	if (statistics != nullptr)
+		statistics->linesSent++;
+	spiRawPair(0x70, 0x0A);  // Also finishes the previous line
+	digitalWrite(chipSelectPin, LOW);
+	pendingLineDriver = this;
+	spiStartLine(buf, len);
+	lineBufferIndex ^= 1;
+}
+
+
+
+/*---- Non-blocking drawing methods ----*/
+
+Status EpaperDriver::beginChange(const uint8_t pixels[], const uint8_t prevPix[]) {
 	// Handle arguments
+	if (step != Step::IDLE)
+		return Status::BUSY;
 	if (prevPix == nullptr)
 		prevPix = previousPixels;
-	if (prevPix == nullptr || pixels == nullptr)
-		return Status::INVALID_ARGUMENT;
-	
-	// Power on the device
-	Status st = powerOn();
-	if (st != Status::OK)
-		return st;
-	
-	// Stage 1: Compensate
-	int iters;
-	if (frameRepeat < 0) {  // Known number of iterations
-		iters = -frameRepeat;  // Won't overflow
-		drawFrame(prevPix, 3, 2, iters);
-	} else if (frameRepeat > 0) {
-		// Measure number of iterations needed to spend 'frameRepeat' milliseconds
-		iters = 0;
-		unsigned long startTime = millis();
-		do {
-			drawFrame(prevPix, 3, 2, 1);
-			iters++;
-		} while (millis() - startTime < static_cast<unsigned long>(frameRepeat));
-	} else
-		return Status::INTERNAL_ERROR;
+	if (!hasPreviousImage(prevPix) || pixels == nullptr) {
+		result = Status::INVALID_ARGUMENT;
+		return result;
+	}
 	
-	drawFrame(prevPix, 2, 0, iters);  // Stage 2: White
-	drawFrame(pixels , 3, 0, iters);  // Stage 3: Inverse
-	drawFrame(pixels , 2, 3, iters);  // Stage 4: Normal
+	operation = Operation::CHANGE_IMAGE;
+	sourcePixels = prevPix;
+	targetPixels = pixels;
+	rowSource = nullptr;
+	return startRefresh();
+}
+
+
+Status EpaperDriver::beginChange(RowSource source, void *context, const uint8_t prevPix[]) {
+	// Handle arguments
+	if (step != Step::IDLE)
+		return Status::BUSY;
+	if (prevPix == nullptr)
+		prevPix = previousPixels;
+	if (!hasPreviousImage(prevPix) || source == nullptr) {
+		result = Status::INVALID_ARGUMENT;
+		return result;
+	}
 	
-	// Save current image into previous
-	if (previousPixels != nullptr)
-		std::memcpy(previousPixels, pixels, getBytesPerLine() * getHeight() * sizeof(pixels[0]));
+	operation = Operation::CHANGE_IMAGE;
+	sourcePixels = prevPix;
+	targetPixels = nullptr;
+	rowSource = source;
+	rowContext = context;
+	return startRefresh();
+}
+
+
+Status EpaperDriver::beginUpdate(const uint8_t pixels[], const uint8_t prevPix[]) {
+	// Handle arguments
+	if (step != Step::IDLE)
+		return Status::BUSY;
+	if (prevPix == nullptr)
+		prevPix = previousPixels;
+	if (!hasPreviousImage(prevPix) || pixels == nullptr) {
+		result = Status::INVALID_ARGUMENT;
+		return result;
+	}
 	
-	// Power off the device
-	powerFinish();
-	return Status::OK;
+	sourcePixels = prevPix;
+	targetPixels = pixels;
+	rowSource = nullptr;
+	return startUpdate();
 }
 
 
-Status EpaperDriver::updateImage(const uint8_t pixels[], const uint8_t prevPix[]) {
+Status EpaperDriver::beginUpdate(RowSource source, void *context, const uint8_t prevPix[]) {
 	// Handle arguments
+	if (step != Step::IDLE)
+		return Status::BUSY;
 	if (prevPix == nullptr)
 		prevPix = previousPixels;
-	if (prevPix == nullptr || pixels == nullptr)
-		return Status::INVALID_ARGUMENT;
+	if (!hasPreviousImage(prevPix) || source == nullptr) {
+		result = Status::INVALID_ARGUMENT;
+		return result;
+	}
+	
+	sourcePixels = prevPix;
+	targetPixels = nullptr;
+	rowSource = source;
+	rowContext = context;
+	return startUpdate();
+}
+
+
+Status EpaperDriver::startUpdate() {
+	// An invalid size has no rows to compare, which must not pass for an unchanged image
+	if (getWidth() == -1) {
+		result = Status::INTERNAL_ERROR;
+		return result;
+	}
 	
-	// Power on the device
-	Status st = powerOn();
-	if (st != Status::OK)
-		return st;
+	// Find the rows that need to be driven, and skip the whole update if none
+	if (statistics != nullptr)
+		*statistics = Statistics{};
+	if (findChangedRows() == 0) {
+		saveTargetImage();
+		result = Status::OK;
+		return result;
+	}
+	operation = Operation::UPDATE_IMAGE;
+	return startRefresh();
+}
+
+
+Status EpaperDriver::beginUpdateRegion(int x, int y, int w, int h, const uint8_t pixels[]) {
+	// Handle arguments
+	if (step != Step::IDLE)
+		return Status::BUSY;
+	if (!hasPreviousImage(previousPixels) || pixels == nullptr
+			|| x < 0 || y < 0 || w < 0 || h < 0
+			|| w > getWidth() - x || h > getHeight() - y) {
+		result = Status::INVALID_ARGUMENT;
+		return result;
+	}
+	if (statistics != nullptr)
+		*statistics = Statistics{};
+	result = Status::OK;  // What poll() reports if nothing needs to be driven
+	if (w == 0 || h == 0)
+		return result;
 	
-	// Loop based on iterations or time
+	// Find the window rows that need to be driven, and skip the whole update if none
 	int bytesPerLine = getBytesPerLine();
-	int height = getHeight();
-	if (frameRepeat < 0) {
-		for (int i = 0; i < -frameRepeat; i++) {  // Won't overflow
-			for (int y = 0; y < height; y++)
-				updateLine(y, &prevPix[y * bytesPerLine], &pixels[y * bytesPerLine]);
+	int srcBytesPerLine = (w + 7) / 8;
+	std::memset(changedRows, 0, sizeof(changedRows));
+	bool anyChanged = false;
+	sourcePixels = previousPixels;
+	for (int i = 0; i < h; i++) {
+		uint8_t line[MAX_LINE_BYTES];
+		uint8_t prevBuf[MAX_LINE_BYTES];
+		const uint8_t *prevLine = getSourceRow(y + i, prevBuf);
+		std::memcpy(line, prevLine, bytesPerLine * sizeof(line[0]));
+		patchRow(line, x, w, &pixels[i * srcBytesPerLine]);
+		if (std::memcmp(line, prevLine, bytesPerLine * sizeof(line[0])) != 0) {
+			changedRows[(y + i) / 8] |= 1 << ((y + i) % 8);
+			anyChanged = true;
 		}
-	} else if (frameRepeat > 0) {
-		unsigned long startTime = millis();
-		do {
-			for (int y = 0; y < height; y++)
-				updateLine(y, &prevPix[y * bytesPerLine], &pixels[y * bytesPerLine]);
-		} while (millis() - startTime < static_cast<unsigned long>(frameRepeat));
-	} else
-		return Status::INTERNAL_ERROR;
+	}
+	if (!anyChanged)
+		return result;
 	
-	// Save current image into previous
-	if (previousPixels != nullptr)
-		std::memcpy(previousPixels, pixels, getBytesPerLine() * getHeight() * sizeof(pixels[0]));
+	operation = Operation::UPDATE_REGION;
+	targetPixels = pixels;
+	rowSource = nullptr;
+	regionX = static_cast<short>(x);
+	regionY = static_cast<short>(y);
+	regionWidth = static_cast<short>(w);
+	regionHeight = static_cast<short>(h);
+	return startRefresh();
+}
+
+
+Status EpaperDriver::poll() {
+	if (step == Step::IDLE)
+		return result;
+	if (waitLength > 0) {
+		if (millis() - waitStart < waitLength && !(waitEndsOnBusy && busyPinFell))
+			return Status::IN_PROGRESS;
+		waitLength = 0;
+	}
 	
-	// Power off the device
-	powerFinish();
-	return Status::OK;
+	if (step < Step::DRAW)
+		powerOnStep();
+	else if (step == Step::DRAW)
+		drawStep();
+	else
+		powerOffStep();
+	return step == Step::IDLE ? result : Status::IN_PROGRESS;
 }
 
 
-void EpaperDriver::drawFrame(const uint8_t pixels[],
-		uint32_t mapWhiteTo, uint32_t mapBlackTo, int iterations) {
-	int bytesPerLine = getBytesPerLine();
-	int height = getHeight();
-	for (int i = 0; i < iterations; i++) {
-		for (int y = 0; y < height; y++)
-			drawLine(y, &pixels[y * bytesPerLine], mapWhiteTo, mapBlackTo, 0x00);
+unsigned long EpaperDriver::getWaitTime() const {
+	if (step == Step::IDLE || waitLength == 0 || (waitEndsOnBusy && busyPinFell))
+		return 0;
+	unsigned long elapsed = millis() - waitStart;
+	return elapsed < waitLength ? waitLength - elapsed : 0;
+}
+
+
+Status EpaperDriver::finishRefresh(Status st) {
+	while (st == Status::IN_PROGRESS) {
+		unsigned long wait = getWaitTime();
+		if (wait > 0) {
+			if (idleHook != nullptr)
+				idleHook(wait);
+			else
+				delay(wait);
+		}
+		st = poll();
 	}
+	return st;
 }
 
 
-void EpaperDriver::drawLine(int row, const uint8_t pixels[],
-		uint32_t mapWhiteTo, uint32_t mapBlackTo, uint8_t border) {
-	spiRawPair(0x70, 0x0A);
-	digitalWrite(chipSelectPin, LOW);
-	SPI.transfer(0x72);
-	if (size == Size::EPD_2_00_INCH || size == Size::EPD_2_71_INCH)
-		SPI.transfer(border);
-	
-	// 'mapping' is a 3-bit to 4-bit look-up table. It has 8 entries of 4 bits each, thus it is 32 bits wide.
-	// 'input' is any integer value, but only bits 0 and 2 are examined (i.e. masked with 0b101).
-	// The 4-bit aligned block in mapping that is returned depends on the value of (input & 5).
-	// If (input & 5) == 0b000, then bits  0 to  3 (inclusive) in mapping are returned.
-	// If (input & 5) == 0b001, then bits  4 to  7 (inclusive) in mapping are returned.
-	// If (input & 5) == 0b100, then bits 16 to 19 (inclusive) in mapping are returned.
-	// If (input & 5) == 0b101, then bits 20 to 23 (inclusive) in mapping are returned.
-	// The other 16 bits in mapping have no effect on the output, regardless of the input value.
-	#define DO_MAP(mapping, input) \
-		(((mapping) >> (((input) & 5) << 2)) & 0xF)
-	int bytesPerLine = getBytesPerLine();
-	
-	// Send even pixels
-	uint32_t evenMap =
-		(mapWhiteTo << 2 | mapWhiteTo) <<  0 |
-		(mapWhiteTo << 2 | mapBlackTo) <<  4 |
-		(mapBlackTo << 2 | mapWhiteTo) << 16 |
-		(mapBlackTo << 2 | mapBlackTo) << 20;
-	for (int x = bytesPerLine - 1; x >= 0; x--) {
-		uint8_t p = pixels[x];
-		uint8_t b = static_cast<uint8_t>(
-			(DO_MAP(evenMap, p >> 4) << 4) |
-			(DO_MAP(evenMap, p >> 0) << 0));
-		SPI.transfer(b);
+Status EpaperDriver::startRefresh() {
+	// Check arguments and state
+	if (panelOnPin < 0 ||
+			chipSelectPin < 0 ||
+			resetPin < 0 ||
+			busyPin < 0 ||
+			(size == Size::EPD_2_71_INCH && borderControlPin < 0) ||
+			dischargePin < 0) {
+		result = Status::INVALID_PIN_CONFIG;
+		return result;
 	}
-	
-	// Send the scan bytes
-	for (int y = getHeight() / 4 - 1; y >= 0; y--) {
-		if (y == row / 4)
-			SPI.transfer(3 << (row % 4 * 2));
-		else
-			SPI.transfer(0x00);
+	if (getWidth() == -1 || frameRepeat[0] == 0
+			|| (lineCodec->size != Size::INVALID && lineCodec->size != size)) {
+		result = Status::INTERNAL_ERROR;
+		return result;
 	}
 	
-	// Send odd pixels
-	uint32_t oddMap =
-		(mapWhiteTo << 2 | mapWhiteTo) <<  0 |
-		(mapWhiteTo << 2 | mapBlackTo) << 16 |
-		(mapBlackTo << 2 | mapWhiteTo) <<  4 |
-		(mapBlackTo << 2 | mapBlackTo) << 20;
-	for (int x = 0; x < bytesPerLine; x++) {
-		uint8_t p = pixels[x];
-		uint8_t b = static_cast<uint8_t>(
-			(DO_MAP(oddMap, p >> 5) << 0) |
-			(DO_MAP(oddMap, p >> 1) << 4));
-		SPI.transfer(b);
+	if (statistics != nullptr && (operation == Operation::CHANGE_IMAGE || operation == Operation::SESSION))
+		*statistics = Statistics{};  // Updates have cleared it already
+	result = Status::OK;
+	if (sessionOpen)
+		startDrawing();
+	else {
+		phaseStart = millis();
+		goToStep(Step::POWER_ON);
 	}
-	
-	#undef DO_MAP
-	if (size == Size::EPD_1_44_INCH)
-		SPI.transfer(border);
-	digitalWrite(chipSelectPin, HIGH);
-	spiWrite(0x02, 0x07);  // Turn on OE: output data from COG driver to panel
+	return poll();
 }
 
 
-void EpaperDriver::updateLine(int row, const uint8_t prevPix[], const uint8_t pixels[]) {
-	spiRawPair(0x70, 0x0A);
-	digitalWrite(chipSelectPin, LOW);
-	SPI.transfer(0x72);
-	if (size == Size::EPD_2_00_INCH || size == Size::EPD_2_71_INCH)
-		SPI.transfer(0x00);
-	int bytesPerLine = getBytesPerLine();
-	
-	// Send even pixels
-	for (int x = bytesPerLine - 1; x >= 0; x--) {
-		uint8_t a = prevPix[x];
-		uint8_t b = pixels[x];
-		uint8_t c = (((a ^ b) & 0x55) << 1) | (b & 0x55);
-		SPI.transfer(c);
+void EpaperDriver::goToStep(Step next, unsigned int wait) {
+	if (next != Step::WAIT_IDLE)
+		detachBusyInterrupt();
+	step = next;
+	waitLength = wait;
+	waitEndsOnBusy = false;
+	if (wait > 0)
+		waitStart = millis();
+}
+
+
+void EpaperDriver::startDrawing() {
+	if (operation == Operation::SESSION) {
+		sessionOpen = true;
+		goToStep(Step::IDLE);
+		return;
 	}
-	
-	// Send the scan bytes
-	for (int y = getHeight() / 4 - 1; y >= 0; y--) {
-		if (y == row / 4)
-			SPI.transfer(3 << (row % 4 * 2));
+	row = operation == Operation::CHANGE_IMAGE ? 0 : static_cast<short>(nextChangedRow(0));
+	if (operation == Operation::CHANGE_IMAGE && changeMode == ChangeMode::FAST)
+		startStage(static_cast<int>(Stage::INVERSE));
+	else
+		startStage(0);
+	goToStep(Step::DRAW);
+}
+
+
+void EpaperDriver::startStage(int index) {
+	stageIndex = static_cast<signed char>(index);
+	frame = 0;
+	short repeat = stageRepeat(index);
+	stageFrames = repeat < 0 ? -repeat : 0;  // Won't overflow
+	stageTime = repeat > 0 ? repeat : 0;
+	phaseStart = millis();
+}
+
+
+short EpaperDriver::stageRepeat(int index) const {
+	if (operation != Operation::CHANGE_IMAGE)
+		return frameRepeat[static_cast<int>(Stage::NORMAL)];
+	short repeat = frameRepeat[index];
+	if (changeMode == ChangeMode::SHORTENED && index < static_cast<int>(Stage::INVERSE)) {
+		// A quarter, rounded away from zero so that the stage isn't skipped
+		if (repeat > 0)
+			repeat = (repeat + 3) / 4;
 		else
-			SPI.transfer(0x00);
+			repeat = -((-repeat + 3) / 4);
 	}
+	return repeat;
+}
+
+
+void EpaperDriver::drawStep() {
+	// Draw one line of the current frame, and advance to the next line
+	int bytesPerLine = lineLayout.bytesPerLine;
+	bool frameDone = false;
+	uint8_t prevLine[MAX_LINE_BYTES];
+	uint8_t line[MAX_LINE_BYTES];
+	if (operation == Operation::CHANGE_IMAGE) {
+		const uint8_t *pixels = stageIndex < 2 ? getSourceRow(row, prevLine) : getTargetRow(row, line);
+		drawLine(row, pixels, static_cast<Stage>(stageIndex), 0x00);
+		row++;
+		if (row >= getHeight()) {
+			row = 0;
+			frameDone = true;
+		}
+	} else {
+		if (operation == Operation::UPDATE_IMAGE)
+			updateLine(row, getSourceRow(row, prevLine), getTargetRow(row, line));
+		else {
+			const uint8_t *prevPix = getSourceRow(row, prevLine);
+			std::memcpy(line, prevPix, bytesPerLine * sizeof(line[0]));
+			patchRow(line, regionX, regionWidth, &targetPixels[(row - regionY) * ((regionWidth + 7) / 8)]);
+			updateLine(row, prevPix, line);
+		}
+		row = static_cast<short>(nextChangedRow(row + 1));
+		if (row == -1) {
+			row = static_cast<short>(nextChangedRow(0));
+			frameDone = true;
+		}
+	}
+	if (frameDone)
+		frame++;
 	
-	// Send odd pixels
-	for (int x = 0; x < bytesPerLine; x++) {
-		uint8_t a = prevPix[x];
-		uint8_t b = pixels[x];
-		uint8_t c = ((a ^ b) & 0xAA) | ((b & 0xAA) >> 1);
-		c = ((c & 0x33) << 2) | ((c >> 2) & 0x33);
-		c = ((c & 0x0F) << 4) | ((c >> 4) & 0x0F);
-		SPI.transfer(c);
+	// In count mode, a stage ends after its number of frames. In time mode, each stage ends at its
+	// own deadline, even partway through a frame, but only after drawing at least one whole frame
+	bool stageDone;
+	if (stageFrames > 0)
+		stageDone = frameDone && frame >= stageFrames;
+	else
+		stageDone = frame > 0 && millis() - phaseStart >= stageTime;
+	if (!stageDone)
+		return;
+	if (!frameDone) {  // Count the partial frame, and start the next stage at the top
+		frame++;
+		row = 0;
+	}
+	recordStage(stageIndex, frame, phaseStart);
+	if (operation == Operation::CHANGE_IMAGE && stageIndex < static_cast<int>(Stage::NORMAL)) {
+		startStage(stageIndex + 1);
+		return;
 	}
 	
-	if (size == Size::EPD_1_44_INCH)
-		SPI.transfer(0x00);
-	digitalWrite(chipSelectPin, HIGH);
-	spiWrite(0x02, 0x07);  // Turn on OE: output data from COG driver to panel
+	// Save current image into previous
+	if (operation == Operation::UPDATE_REGION) {
+		int srcBytesPerLine = (regionWidth + 7) / 8;
+		CompressedImage *store = getPreviousStore();
+		for (int i = 0; i < regionHeight; i++) {
+			const uint8_t *window = &targetPixels[i * srcBytesPerLine];
+			if (previousPixels != nullptr)
+				patchRow(&previousPixels[(regionY + i) * bytesPerLine], regionX, regionWidth, window);
+			else if (store != nullptr) {
+				store->getRow(regionY + i, line);
+				patchRow(line, regionX, regionWidth, window);
+				store->setRow(regionY + i, line);
+			}
+		}
+	} else
+		saveTargetImage();
+	
+	if (sessionOpen) {
+		finishPendingLine();  // Don't leave the last line unlatched until the next refresh
+		goToStep(Step::IDLE);
+	} else {
+		row = 0;
+		phaseStart = millis();
+		goToStep(Step::NOTHING_FRAME);
+	}
+}
+
+
+
+/*---- Session methods ----*/
+
+Status EpaperDriver::beginSession() {
+	if (step != Step::IDLE)
+		return Status::BUSY;
+	if (sessionOpen) {
+		result = Status::OK;
+		return result;
+	}
+	operation = Operation::SESSION;
+	return finishRefresh(startRefresh());
+}
+
+
+Status EpaperDriver::endSession() {
+	if (step != Step::IDLE)
+		return Status::BUSY;
+	if (!sessionOpen) {
+		result = Status::OK;
+		return result;
+	}
+	if (statistics != nullptr)
+		*statistics = Statistics{};
+	sessionOpen = false;
+	result = Status::OK;
+	row = 0;
+	phaseStart = millis();
+	goToStep(Step::NOTHING_FRAME);
+	return finishRefresh(poll());
 }
 
 
@@ -278,12 +972,7 @@ void EpaperDriver::updateLine(int row, const uint8_t prevPix[], const uint8_t pi
 /*---- Image dimension methods ----*/
 
 int EpaperDriver::getWidth() const {
-	switch (size) {
-		case Size::EPD_1_44_INCH:  return 128;
-		case Size::EPD_2_00_INCH:  return 200;
-		case Size::EPD_2_71_INCH:  return 264;
-		default:  return -1;  // Illegal argument
-	}
+	return widthOf(size);
 }
 
 
@@ -293,86 +982,178 @@ int EpaperDriver::getBytesPerLine() const {
 
 
 int EpaperDriver::getHeight() const {
-	switch (size) {
-		case Size::EPD_1_44_INCH:  return  96;
-		case Size::EPD_2_00_INCH:  return  96;
-		case Size::EPD_2_71_INCH:  return 176;
-		default:  return -1;  // Illegal argument
-	}
+	return heightOf(size);
 }
 
 
 
 /*---- Power methods ----*/
 
-Status EpaperDriver::powerOn() {
-	// Check arguments and state
-	if (panelOnPin < 0 ||
-			chipSelectPin < 0 ||
-			resetPin < 0 ||
-			busyPin < 0 ||
-			(size == Size::EPD_2_71_INCH && borderControlPin < 0) ||
-			dischargePin < 0)
-		return Status::INVALID_PIN_CONFIG;
-	
-	// Set I/O pin directions
-	pinMode(panelOnPin   , OUTPUT);
-	pinMode(chipSelectPin, OUTPUT);
-	pinMode(resetPin     , OUTPUT);
-	pinMode(busyPin      , INPUT);
-	if (size == Size::EPD_2_71_INCH)
-		pinMode(borderControlPin, OUTPUT);
-	pinMode(dischargePin , OUTPUT);
-	
-	// Set initial pin values
-	digitalWrite(panelOnPin   , HIGH);
-	digitalWrite(chipSelectPin, HIGH);
-	if (size == Size::EPD_2_71_INCH)
-		digitalWrite(borderControlPin, HIGH);
-	digitalWrite(resetPin     , HIGH);
-	digitalWrite(dischargePin , LOW);
-	delay(5);
-	
-	// Pulse the reset pin
-	digitalWrite(resetPin, LOW);
-	delay(5);
-	digitalWrite(resetPin, HIGH);
-	delay(5);
-	return powerInit();
+void EpaperDriver::powerOnStep() {
+	switch (step) {
+		case Step::POWER_ON:
+			// Set I/O pin directions
+			pinMode(panelOnPin   , OUTPUT);
+			pinMode(chipSelectPin, OUTPUT);
+			pinMode(resetPin     , OUTPUT);
+			pinMode(busyPin      , INPUT);
+			if (size == Size::EPD_2_71_INCH)
+				pinMode(borderControlPin, OUTPUT);
+			pinMode(dischargePin , OUTPUT);
+			
+			// Set initial pin values
+			digitalWrite(panelOnPin   , HIGH);
+			digitalWrite(chipSelectPin, HIGH);
+			if (size == Size::EPD_2_71_INCH)
+				digitalWrite(borderControlPin, HIGH);
+			digitalWrite(resetPin     , HIGH);
+			digitalWrite(dischargePin , LOW);
+			goToStep(Step::RESET_LOW, 5);
+			break;
+		
+		case Step::RESET_LOW:  // Pulse the reset pin
+			digitalWrite(resetPin, LOW);
+			goToStep(Step::RESET_HIGH, 5);
+			break;
+		
+		case Step::RESET_HIGH:
+			digitalWrite(resetPin, HIGH);
+			goToStep(Step::WAIT_IDLE, 5);
+			break;
+		
+		case Step::WAIT_IDLE:
+			// The interrupt stays attached for the whole wait (goToStep() detaches it)
+			if (useBusyInterrupt && busyInterruptSlot == -1)
+				attachBusyInterrupt();
+			busyPinFell = false;
+			if (digitalRead(busyPin) == LOW)
+				goToStep(Step::INIT);
+			else if (busyInterruptSlot != -1) {
+				// Wait for the falling edge, checking the pin again in case the edge was missed
+				goToStep(Step::WAIT_IDLE, BUSY_INTERRUPT_WAIT);
+				waitEndsOnBusy = true;
+			} else
+				goToStep(Step::WAIT_IDLE, 1);
+			break;
+		
+		case Step::INIT:
+			powerInit();
+			break;
+		
+		// Give a few attempts to turn on power
+		case Step::PUMP_POSITIVE:
+			if (powerAttempt == 0)
+				pumpStart = millis();
+			powerAttempt++;
+			if (statistics != nullptr)
+				statistics->powerAttempts = powerAttempt;
+			spiWrite(0x05, 0x01);  // Start charge pump positive voltage, VGH & VDH on
+			goToStep(Step::PUMP_NEGATIVE, 150);
+			break;
+		
+		case Step::PUMP_NEGATIVE:
+			spiWrite(0x05, 0x03);  // Start charge pump negative voltage, VGL & VDL on
+			goToStep(Step::PUMP_VCOM, 90);
+			break;
+		
+		case Step::PUMP_VCOM:
+			spiWrite(0x05, 0x0F);  // Set charge pump Vcom on
+			vcomStart = millis();
+			if (pollDcDc)
+				goToStep(Step::CHECK_DC, DC_POLL_INTERVAL);
+			else
+				goToStep(Step::CHECK_DC, VCOM_SETTLE_TIME);
+			break;
+		
+		case Step::CHECK_DC:
+			if ((spiRead(0x0F) & 0x40) != 0) {  // Check DC/DC
+				spiWrite(0x02, 0x06);  // Output enable to disable
+				if (statistics != nullptr) {
+					statistics->powerOnTime = millis() - phaseStart;
+					statistics->chargePumpTime = millis() - pumpStart;
+				}
+				startDrawing();  // Success
+			} else if (pollDcDc && millis() - vcomStart < VCOM_SETTLE_TIME) {
+				// Check again a bit later, up to the time that the fixed wait would take
+				unsigned long remain = VCOM_SETTLE_TIME - (millis() - vcomStart);
+				goToStep(Step::CHECK_DC, remain < DC_POLL_INTERVAL ? remain : DC_POLL_INTERVAL);
+			} else if (powerAttempt < 4)
+				goToStep(Step::PUMP_POSITIVE);
+			else
+				failRefresh(Status::DC_FAIL);
+			break;
+		
+		default:
+			failRefresh(Status::INTERNAL_ERROR);
+			break;
+	}
 }
 
 
-Status EpaperDriver::powerInit() {
-	// Wait until idle
-	while (digitalRead(busyPin) == HIGH)
-		delay(1);
-	
+void EpaperDriver::attachBusyInterrupt() {
+	static void (*const HANDLERS[BUSY_INTERRUPT_SLOTS])() = {
+		busyPinInterrupt<0>, busyPinInterrupt<1>, busyPinInterrupt<2>, busyPinInterrupt<3>,
+		busyPinInterrupt<4>, busyPinInterrupt<5>, busyPinInterrupt<6>, busyPinInterrupt<7>,
+	};
+	for (int i = 0; i < BUSY_INTERRUPT_SLOTS; i++) {
+		if (busyInterruptDrivers[i] == nullptr) {
+			busyInterruptDrivers[i] = this;
+			busyInterruptSlot = static_cast<signed char>(i);
+			attachInterrupt(digitalPinToInterrupt(busyPin), HANDLERS[i], FALLING);
+			return;
+		}
+	}
+}
+
+
+void EpaperDriver::detachBusyInterrupt() {
+	if (busyInterruptSlot == -1)
+		return;
+	detachInterrupt(digitalPinToInterrupt(busyPin));
+	busyInterruptDrivers[busyInterruptSlot] = nullptr;
+	busyInterruptSlot = -1;
+}
+
+
+template <int I>
+void EpaperDriver::busyPinInterrupt() {
+	EpaperDriver *epd = busyInterruptDrivers[I];
+	if (epd != nullptr)
+		epd->busyPinFell = true;
+}
+
+
+void EpaperDriver::powerInit() {
 	// Configure and start SPI
-	SPI.begin();
-	SPI.setBitOrder(MSBFIRST);
-	SPI.setClockDivider(SPI_CLOCK_DIV2);
-	if (__MSP432P401R__)
-		SPI.setDataMode(SPI_MODE1);  // Workaround for off-spec behavior
-	else
-		SPI.setDataMode(SPI_MODE0);
+	finishPendingLine();  // Of another driver
+	if (!spiInUse) {
+		spiInUse = true;
+		spiUsers++;
+		if (spiUsers == 1) {  // Otherwise another driver has begun it with the same settings
+			SPI.begin();
+			SPI.setBitOrder(MSBFIRST);
+			SPI.setClockDivider(SPI_CLOCK_DIV2);
+			if (__MSP432P401R__)
+				SPI.setDataMode(SPI_MODE1);  // Workaround for off-spec behavior
+			else
+				SPI.setDataMode(SPI_MODE0);
+		}
+	}
 	
 	// Check chip ID. G1 COG driver's ID is 0x11, G2 is 0x12
 	if (spiGetId() != 0x12) {
-		powerOff();
-		return Status::INVALID_CHIP_ID;
+		failRefresh(Status::INVALID_CHIP_ID);
+		return;
 	}
 	
 	spiWrite(0x02, 0x40);  // Disable OE
 	if ((spiRead(0x0F) & 0x80) == 0) {
-		powerOff();
-		return Status::BROKEN_PANEL;
+		failRefresh(Status::BROKEN_PANEL);
+		return;
 	}
 	spiWrite(0x0B, 0x02);  // Power saving mode
 	
 	// Channel select
-	spiRawPair(0x70, 0x01);
-	digitalWrite(chipSelectPin, LOW);
-	SPI.transfer(0x72);
 	static const uint8_t chanSel144[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x0F, 0xFF, 0x00};
 	static const uint8_t chanSel200[] = {0x00, 0x00, 0x00, 0x00, 0x01, 0xFF, 0xE0, 0x00};
 	static const uint8_t chanSel271[] = {0x00, 0x00, 0x00, 0x7F, 0xFF, 0xFE, 0x00, 0x00};
@@ -381,81 +1162,104 @@ Status EpaperDriver::powerInit() {
 		case Size::EPD_1_44_INCH:  chanSel = chanSel144;  break;
 		case Size::EPD_2_00_INCH:  chanSel = chanSel200;  break;
 		case Size::EPD_2_71_INCH:  chanSel = chanSel271;  break;
-		default:  return Status::INTERNAL_ERROR;
+		default:  failRefresh(Status::INTERNAL_ERROR);  return;
 	}
-	for (int i = 0; i < 8; i++)
-		SPI.transfer(chanSel[i]);
-	digitalWrite(chipSelectPin, HIGH);
+	lineLayout = makeLineLayout(size);
 	
-	spiWrite(0x07, 0xD1);  // High power mode osc setting
-	spiWrite(0x08, 0x02);  // Power setting
-	spiWrite(0x09, 0xC2);  // Set Vcom level
-	spiWrite(0x04, 0x03);  // Power setting
-	spiWrite(0x03, 0x01);  // Driver latch on
-	spiWrite(0x03, 0x00);  // Driver latch off
-	delay(5);
+	uint8_t chanSelWrite[9] = {0x72};  // Data header followed by the channel bytes
+	std::memcpy(&chanSelWrite[1], chanSel, 8 * sizeof(chanSel[0]));
+	spiRawPair(0x70, 0x01);
+	digitalWrite(chipSelectPin, LOW);
+	spiWriteBlock(chanSelWrite, 9);
+	digitalWrite(chipSelectPin, HIGH);
 	
-	// Give a few attempts to turn on power
-	for (int i = 0; i < 4; i++) {
-		spiWrite(0x05, 0x01);  // Start charge pump positive voltage, VGH & VDH on
-		delay(150);
-		spiWrite(0x05, 0x03);  // Start charge pump negative voltage, VGL & VDL on
-		delay(90);
-		spiWrite(0x05, 0x0F);  // Set charge pump Vcom on
-		delay(40);
-		if ((spiRead(0x0F) & 0x40) != 0) {  // Check DC/DC
-			spiWrite(0x02, 0x06);  // Output enable to disable
-			return Status::OK;  // Success
-		}
+	spiWriteList(POWER_SETTINGS, sizeof(POWER_SETTINGS) / sizeof(POWER_SETTINGS[0]));
+	powerAttempt = 0;
+	goToStep(Step::PUMP_POSITIVE, 5);
+}
+
+
+void EpaperDriver::powerOffStep() {
+	switch (step) {
+		case Step::NOTHING_FRAME:
+			drawLine(row, nullptr, Stage::NOTHING, 0x00);
+			row++;
+			if (row == getHeight())
+				goToStep(Step::DUMMY_LINE);
+			break;
+		
+		case Step::DUMMY_LINE:
+			if (size == Size::EPD_2_71_INCH) {
+				drawLine(-4, nullptr, Stage::NOTHING, 0x00);  // Dummy line
+				finishPendingLine();
+				goToStep(Step::BORDER_LOW, 25);
+			} else {
+				drawLine(-4, nullptr, Stage::NOTHING, 0xAA);  // Border dummy line
+				finishPendingLine();
+				goToStep(Step::POWER_OFF);
+			}
+			break;
+		
+		case Step::BORDER_LOW:  // Pulse the border pin
+			digitalWrite(borderControlPin, LOW);
+			goToStep(Step::BORDER_HIGH, 100);
+			break;
+		
+		case Step::BORDER_HIGH:
+			digitalWrite(borderControlPin, HIGH);
+			goToStep(Step::POWER_OFF);
+			break;
+		
+		case Step::POWER_OFF:
+			spiWriteList(CHARGE_PUMP_OFF, sizeof(CHARGE_PUMP_OFF) / sizeof(CHARGE_PUMP_OFF[0]));
+			goToStep(Step::DISCHARGE_INTERNAL, 300);
+			break;
+		
+		case Step::DISCHARGE_INTERNAL:
+			spiWriteList(DISCHARGE_INTERNAL, sizeof(DISCHARGE_INTERNAL) / sizeof(DISCHARGE_INTERNAL[0]));
+			if (spiInUse) {
+				spiInUse = false;
+				spiUsers--;
+				if (spiUsers == 0)
+					SPI.end();
+			}
+			goToStep(Step::PANEL_OFF, 50);
+			break;
+		
+		case Step::PANEL_OFF:
+			if (size == Size::EPD_2_71_INCH)
+				digitalWrite(borderControlPin, LOW);
+			digitalWrite(panelOnPin, LOW);
+			goToStep(Step::DISCHARGE_START, 10);
+			break;
+		
+		case Step::DISCHARGE_START:
+			digitalWrite(resetPin, LOW);
+			digitalWrite(chipSelectPin, LOW);
+			// Pulse the discharge pin
+			digitalWrite(dischargePin, HIGH);
+			goToStep(Step::DISCHARGE_END, 150);
+			break;
+		
+		case Step::DISCHARGE_END:
+			digitalWrite(dischargePin, LOW);
+			if (statistics != nullptr)
+				statistics->powerOffTime = millis() - phaseStart;
+			goToStep(Step::IDLE);
+			break;
+		
+		default:
+			result = Status::INTERNAL_ERROR;
+			goToStep(Step::IDLE);
+			break;
 	}
-	powerOff();
-	return Status::DC_FAIL;
 }
 
 
-void EpaperDriver::powerFinish() {
-	// Array length must be the maximum value of getBytesPerLine() among all sizes
-	uint8_t whiteLine[33] = {};
-	for (int i = 0, height = getHeight(); i < height; i++)  // Nothing frame
-		drawLine(i, whiteLine, 0, 0, 0x00);
-	
-	if (size == Size::EPD_1_44_INCH || size == Size::EPD_2_00_INCH)
-		drawLine(-4, whiteLine, 0, 0, 0xAA);  // Border dummy line
-	else if (size == Size::EPD_2_71_INCH) {
-		drawLine(-4, whiteLine, 0, 0, 0x00);  // Dummy line
-		// Pulse the border pin
-		delay(25);
-		digitalWrite(borderControlPin, LOW);
-		delay(100);
-		digitalWrite(borderControlPin, HIGH);
-	}
-	powerOff();
-}
-
-
-void EpaperDriver::powerOff() {
-	spiWrite(0x0B, 0x00);  // Undocumented
-	spiWrite(0x03, 0x01);  // Latch reset turn on
-	spiWrite(0x05, 0x03);  // Power off charge pump, Vcom off
-	spiWrite(0x05, 0x01);  // Power off charge pump negative voltage, VGL & VDL off
-	delay(300);
-	spiWrite(0x04, 0x80);  // Discharge internal
-	spiWrite(0x05, 0x00);  // Power off charge pump positive voltage, VGH & VDH off
-	spiWrite(0x07, 0x01);  // Turn off osc
-	SPI.end();
-	delay(50);
-	
-	if (size == Size::EPD_2_71_INCH)
-		digitalWrite(borderControlPin, LOW);
-	digitalWrite(panelOnPin, LOW);
-	delay(10);
-	digitalWrite(resetPin, LOW);
-	digitalWrite(chipSelectPin, LOW);
-	
-	// Pulse the discharge pin
-	digitalWrite(dischargePin, HIGH);
-	delay(150);
-	digitalWrite(dischargePin, LOW);
+void EpaperDriver::failRefresh(Status st) {
+	result = st;
+	phaseStart = millis();
+	goToStep(Step::POWER_OFF);
 }
 
 
@@ -468,6 +1272,15 @@ void EpaperDriver::spiWrite(uint8_t cmdIndex, uint8_t cmdData) {
 }
 
 
+void EpaperDriver::spiWriteList(const uint8_t cmds[][2], int count) {
+	// The index and data of each write must be separate chip select frames
+	for (int i = 0; i < count; i++) {
+		spiRawPair(0x70, cmds[i][0]);
+		spiRawPair(0x72, cmds[i][1]);
+	}
+}
+
+
 uint8_t EpaperDriver::spiRead(uint8_t cmdIndex) {
 	spiRawPair(0x70, cmdIndex);
 	return spiRawPair(0x73, 0x00);
@@ -480,10 +1293,58 @@ uint8_t EpaperDriver::spiGetId() {
 
 
 uint8_t EpaperDriver::spiRawPair(uint8_t b0, uint8_t b1) {
+	finishPendingLine();
+	if (statistics != nullptr)
+		statistics->bytesSent += 2;
 	// Initially must have chipSelectPin at HIGH, held for at least 80 nanoseconds
 	digitalWrite(chipSelectPin, LOW);
 	SPI.transfer(b0);
-	uint8_t result = SPI.transfer(b1);
+	uint8_t received = SPI.transfer(b1);
 	digitalWrite(chipSelectPin, HIGH);
-	return result;
+	return received;
+}
+
+
+void EpaperDriver::spiWriteBlock(uint8_t data[], int len) {
+	if (statistics != nullptr)
+		statistics->bytesSent += static_cast<unsigned long>(len);
+	#if defined(CORE_TEENSY)
+		SPI.transfer(data, nullptr, len);  // Transmit-only, keeps the FIFO full
+	#elif __MSP432P401R__
+		for (int i = 0; i < len; i++)  // This SPI library has no buffer transfer
+			SPI.transfer(data[i]);
+	#else
+		SPI.transfer(data, len);  // Overwrites the data with the received bytes
+	#endif
+}
+
+
+void EpaperDriver::spiStartLine(uint8_t data[], int len) {
+	#if defined(SPI_HAS_TRANSFER_ASYNC)
+		// Teensyduino: the DMA clocks out the line while the caller encodes the next one
+		lineTransferDone = false;
+		lineTransferEvent.attachImmediate(lineTransferCallback);
+		if (SPI.transfer(data, nullptr, len, lineTransferEvent)) {
+			if (statistics != nullptr)
+				statistics->bytesSent += static_cast<unsigned long>(len);
+			return;
+		}
+		lineTransferDone = true;  // DMA unavailable, so fall back to a blocking transfer
+	#endif
+	spiWriteBlock(data, len);
+	finishPendingLine();
+}
+
+
+void EpaperDriver::finishPendingLine() {
+	EpaperDriver *epd = pendingLineDriver;
+	if (epd == nullptr)
+		return;
+	pendingLineDriver = nullptr;
+	#if defined(SPI_HAS_TRANSFER_ASYNC)
+		while (!lineTransferDone)
+			yield();
+	#endif
+	digitalWrite(epd->chipSelectPin, HIGH);
+	epd->spiWrite(0x02, 0x07);  // Turn on OE: output data from COG driver to panel
 }
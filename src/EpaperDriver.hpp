@@ -21,7 +21,10 @@
  *   Software.
  */
 
+#pragma once
+
 #include <cstdint>
+#include "CompressedImage.hpp"
 
 
 /* 
@@ -43,7 +46,7 @@
  *   if (st != Status::OK)
  *     print(st);  // Diagnostic info
  */
-class EpaperDriver final {
+class EpaperDriver {
 	
 	/*---- Helper enums ----*/
 	
@@ -59,6 +62,92 @@ class EpaperDriver final {
 	};
 	
 	
+	// Pixel mappings used when drawing a frame or line. Each of the four stages of
+	// changeImage() maps white and black pixels to a pair of 2-bit drive values,
+	// whereas NOTHING maps every pixel to the nothing value.
+	private: enum class Stage : unsigned char {
+		COMPENSATE,  // White to 3, black to 2
+		WHITE,       // White to 2, black to 0
+		INVERSE,     // White to 3, black to 0
+		NORMAL,      // White to 2, black to 3
+		NOTHING,     // Both to 0
+	};
+	
+	
+	// How changeImage() trades image quality for speed, by shortening or skipping
+	// the compensate and white stages, which erase the previous image.
+	public: enum class ChangeMode : unsigned char {
+		FULL,       // All four stages with their full times or repeats (the default)
+		SHORTENED,  // Compensate and white stages at a quarter of their times or repeats
+		FAST,       // Only the inverse and normal stages, leaving more ghosting of the previous image
+	};
+	
+	
+	// The kinds of refresh that the non-blocking state machine performs.
+	private: enum class Operation : unsigned char {
+		CHANGE_IMAGE,   // beginChange()
+		UPDATE_IMAGE,   // beginUpdate()
+		UPDATE_REGION,  // beginUpdateRegion()
+		SESSION,        // beginSession(), which only powers on
+	};
+	
+	
+	// The steps of a refresh, in order of execution. Each call to poll() performs one step,
+	// or one line of a line drawing step, and a step may set a wait before the next one.
+	private: enum class Step : unsigned char {
+		IDLE,                // No refresh in progress
+		POWER_ON,            // Set pin directions and initial values
+		RESET_LOW,
+		RESET_HIGH,
+		WAIT_IDLE,           // Until the busy pin is low
+		INIT,                // Start SPI, check the COG driver, send the settings
+		PUMP_POSITIVE,
+		PUMP_NEGATIVE,
+		PUMP_VCOM,
+		CHECK_DC,            // Then draw (or open a session), retry the charge pump, or power off
+		DRAW,                // All stages (or update frames), one line per step
+		NOTHING_FRAME,       // One line per step
+		DUMMY_LINE,
+		BORDER_LOW,          // 2.71" only
+		BORDER_HIGH,         // 2.71" only
+		POWER_OFF,
+		DISCHARGE_INTERNAL,
+		PANEL_OFF,
+		DISCHARGE_START,
+		DISCHARGE_END,
+	};
+	
+	
+	// Measurements of one refresh by changeImage(), updateImage() or updateRegion() (or their
+	// non-blocking counterparts), filled in by the driver if the field statistics is not null.
+	// Times are in milliseconds, as per millis().
+	public: struct Statistics {
+		unsigned long powerOnTime;       // From the start of the refresh until the charge pump is up
+		unsigned char powerAttempts;     // Number of charge pump attempts made, from 1 to 4
+		unsigned long chargePumpTime;    // From the first charge pump write until the DC/DC reported ready
+		unsigned short stageFrames[4];   // Frames drawn in each stage; an update has only stage 0
+		unsigned long stageTime[4];      // Time spent in each stage
+		unsigned long linesSent;         // All line writes, including the nothing frame and dummy line
+		unsigned long bytesSent;         // All SPI bytes, including commands and reads
+		unsigned long powerOffTime;      // From the end of the last stage until the panel is discharged
+	};
+	
+	
+	// One breakpoint of a waveform table: how long (in milliseconds) each
+	// stage of changeImage() should take at the given temperature.
+	public: struct WaveformPoint {
+		signed char temperature;      // Degrees Celsius
+		unsigned short stageTime[4];  // Compensate, white, inverse, normal; each in [1, 32767]
+	};
+	
+	
+	// Function that stores the given row of an image into the given array (getBytesPerLine()
+	// bytes, in the same format as one row of an image array), for the drawing methods that
+	// take a row source instead of an image array. The context is the pointer that was given
+	// to the drawing method, e.g. to the parameters of the image being rendered.
+	public: using RowSource = void (*)(int row, std::uint8_t pixels[], void *context);
+	
+	
 	// Return codes for various methods.
 	public: enum class Status : unsigned char {
 		INTERNAL_ERROR = 0,
@@ -68,12 +157,32 @@ class EpaperDriver final {
 		BROKEN_PANEL,
 		DC_FAIL,
 		INVALID_ARGUMENT,
+		IN_PROGRESS,  // The non-blocking refresh has started or continues
+		BUSY,         // A non-blocking refresh was begun while another one is in progress
 	};
 	
 	
 	
 	/*---- Fields ----*/
 	
+	// The longest line write among all sizes: header, border, 33 even bytes, 44 scan bytes, 33 odd bytes.
+	private: static constexpr int MAX_LINE_BYTES = 1 + 1 + 33 + 44 + 33;
+	
+	// The largest value of getHeight() among all sizes.
+	private: static constexpr int MAX_HEIGHT = 176;
+	
+	// The vendor's wait after turning on the charge pump's Vcom, before the DC/DC check,
+	// and the interval between checks when pollDcDc is true, in milliseconds.
+	private: static constexpr unsigned int VCOM_SETTLE_TIME = 40;
+	private: static constexpr unsigned int DC_POLL_INTERVAL = 2;
+	
+	// The longest wait for a busy pin interrupt before reading the pin again, in milliseconds.
+	private: static constexpr unsigned int BUSY_INTERRUPT_WAIT = 10;
+	
+	// The number of drivers that can wait for a busy pin interrupt at the same time.
+	// A driver that finds every slot taken reads the pin every millisecond instead.
+	private: static constexpr int BUSY_INTERRUPT_SLOTS = 8;
+	
 	// Pin configuration. Before calling powerOn(), each pin must be set to a
 	// non-negative unique value. All the pins listed here must be connected
 	// between the microcontroller and the EPD hardware. Also, it is implied
@@ -90,14 +199,182 @@ class EpaperDriver final {
 	// If this is not null, then the memory must be initialized because it will be read.
 	public: std::uint8_t *previousPixels = nullptr;
 	
+	// Compressed store for reading and writing the previous image, used instead of previousPixels
+	// if that is null, to save RAM. Can be null. Its dimensions must match the size. If it becomes
+	// invalid because its buffer is full, then drawing methods that need the previous image return
+	// INVALID_ARGUMENT until it is cleared or set (and changeImage() can be given the previous image).
+	public: CompressedImage *previousStore = nullptr;
+	
 	// The size of the EPD being driven.
 	public: Size size;
 	
+	// Whether to poll the DC/DC status while the charge pump's Vcom step settles, and start
+	// drawing as soon as it reports ready, instead of always waiting the vendor's fixed 40 ms
+	// before checking once. The wait is never longer than the fixed one. The positive and
+	// negative voltage steps still have their fixed waits, because their progress can't be read.
+	public: bool pollDcDc = false;
+	
+	// Function that the blocking methods call instead of delay() when the driver has to wait,
+	// with the number of milliseconds until the driver can make progress, e.g. to do other work
+	// or to sleep in a low power mode. It may return early (e.g. when woken by an interrupt), in
+	// which case it is called again with the remaining time. Returning late delays the refresh,
+	// and in time mode reduces the number of frames drawn. Null (the default) means delay().
+	public: void (*idleHook)(unsigned long millis) = nullptr;
+	
+	// Whether to wait for the busy pin to go low with a falling edge interrupt (which requires
+	// the pin to support attachInterrupt()) rather than reading it every millisecond. The wait
+	// then ends at the edge, so an idle hook or poll() caller can sleep until the interrupt.
+	// The interrupt is attached only during that wait, with a handler of this driver's own,
+	// so several drivers (e.g. in an EpaperDriverGroup) can wait at the same time.
+	public: bool useBusyInterrupt = false;
+	
+	// Where to store measurements of each drawing call. Can be null (the default) for
+	// no measurements. Every drawing call clears the structure before filling it in,
+	// so fields not applicable to the call (or to an early return) are left as zero.
+	public: Statistics *statistics = nullptr;
+	
 	// Controls how many times or for how long a frame of each stage
 	// is redrawn. Zero is invalid. Default value is a sane setting.
 	// Positive value indicates the number of milliseconds.
 	// Negative value indicates the number of repetitions.
-	private: short frameRepeat;
+	// The four elements are indexed by Stage and all have the same sign, which every
+	// setter keeps by setting all four (see setStageTimes() and setStageRepeats()).
+	private: short frameRepeat[4];
+	
+	private: ChangeMode changeMode = ChangeMode::FULL;
+	
+	// The table used by setWaveformByTemperature(), sorted by temperature. Not owned.
+	private: const WaveformPoint *waveformTable;
+	private: unsigned char waveformLength;
+	
+	// Positions and lengths of the parts of a line write for the current size, in bytes. Set by
+	// powerInit() so that encoding a line needs no size-dependent switches or branches.
+	private: struct LineLayout {
+		unsigned char bytesPerLine;
+		unsigned char scanBytes;    // Height divided by 4
+		unsigned char borderIndex;  // Follows the data header (2.00", 2.71") or the odd pixels (1.44")
+		unsigned char evenIndex;
+		unsigned char scanIndex;
+		unsigned char oddIndex;
+		unsigned char length;
+	} lineLayout = {};
+	
+	// Returns the width of the given size in pixels, or -1 if the size is invalid.
+	private: static constexpr int widthOf(Size sz) {
+		return sz == Size::EPD_1_44_INCH ? 128 :
+		       sz == Size::EPD_2_00_INCH ? 200 :
+		       sz == Size::EPD_2_71_INCH ? 264 : -1;
+	}
+	
+	// Returns the height of the given size in pixels, or -1 if the size is invalid.
+	private: static constexpr int heightOf(Size sz) {
+		return sz == Size::EPD_1_44_INCH ?  96 :
+		       sz == Size::EPD_2_00_INCH ?  96 :
+		       sz == Size::EPD_2_71_INCH ? 176 : -1;
+	}
+	
+	// Returns the line layout of the given valid size.
+	private: static constexpr LineLayout makeLineLayout(Size sz) {
+		return makeLineLayout(widthOf(sz) / 8, heightOf(sz) / 4, sz != Size::EPD_1_44_INCH);
+	}
+	
+	// Every line write has the header, the border byte and two bytes per 8 pixels and 4 rows.
+	private: static constexpr LineLayout makeLineLayout(int bytesPerLine, int scanBytes, bool borderFirst) {
+		return LineLayout{
+			static_cast<unsigned char>(bytesPerLine),
+			static_cast<unsigned char>(scanBytes),
+			static_cast<unsigned char>(borderFirst ? 1 : 1 + bytesPerLine * 2 + scanBytes),
+			static_cast<unsigned char>(borderFirst ? 2 : 1),
+			static_cast<unsigned char>((borderFirst ? 2 : 1) + bytesPerLine),
+			static_cast<unsigned char>((borderFirst ? 2 : 1) + bytesPerLine + scanBytes),
+			static_cast<unsigned char>(2 + bytesPerLine * 2 + scanBytes),
+		};
+	}
+	
+	// The functions that encode line writes, given the line layout and a buffer of
+	// length at least MAX_LINE_BYTES, and return the length. See drawLine() and updateLine().
+	private: struct LineCodec {
+		Size size;  // The only size that the functions support, or INVALID if they support any size
+		int (*stageLine)(const LineLayout &layout, std::uint8_t buf[], int row,
+			std::uint8_t border, const std::uint8_t pixels[], Stage stage);
+		int (*updateLine)(const LineLayout &layout, std::uint8_t buf[], int row,
+			const std::uint8_t prevPix[], const std::uint8_t pixels[]);
+	};
+	
+	// The line encoders for any size, which read the layout.
+	private: static const LineCodec GENERIC_LINE_CODEC;
+	
+	// The line encoders of this driver, which are specialized for one size in EpaperDriverT.
+	private: const LineCodec *lineCodec;
+	
+	// The line layout of one size as compile-time constants, with the same members as LineLayout,
+	// and line encoders that are instantiated with it and ignore their layout argument.
+	private: template <Size S> struct FixedLineLayout {
+		static constexpr unsigned char bytesPerLine = makeLineLayout(S).bytesPerLine;
+		static constexpr unsigned char scanBytes    = makeLineLayout(S).scanBytes   ;
+		static constexpr unsigned char borderIndex  = makeLineLayout(S).borderIndex ;
+		static constexpr unsigned char evenIndex    = makeLineLayout(S).evenIndex   ;
+		static constexpr unsigned char scanIndex    = makeLineLayout(S).scanIndex   ;
+		static constexpr unsigned char oddIndex     = makeLineLayout(S).oddIndex    ;
+		static constexpr unsigned char length       = makeLineLayout(S).length      ;
+		
+		static const LineCodec CODEC;
+		
+		static int stageLine(const LineLayout &layout, std::uint8_t buf[], int row,
+			std::uint8_t border, const std::uint8_t pixels[], Stage stage);
+		static int updateLine(const LineLayout &layout, std::uint8_t buf[], int row,
+			const std::uint8_t prevPix[], const std::uint8_t pixels[]);
+	};
+	
+	template <Size S> friend class EpaperDriverT;
+	
+	// State of the refresh that poll() advances. Apart from step and result, these
+	// are only meaningful while a refresh is in progress (step is not IDLE).
+	private: Step step = Step::IDLE;
+	private: bool sessionOpen = false;  // Whether the device is kept powered on between refreshes
+	private: Status result = Status::OK;  // Returned by poll() once the refresh is finished
+	private: Operation operation = Operation::CHANGE_IMAGE;
+	private: unsigned long waitStart = 0;  // Value of millis() when the current wait began
+	private: unsigned int waitLength = 0;  // Milliseconds that must elapse before the next step
+	private: bool waitEndsOnBusy = false;  // Whether the wait also ends when the busy pin falls
+	private: volatile bool busyPinFell = false;  // Set by this driver's busy pin interrupt handler
+	private: signed char busyInterruptSlot = -1;  // Index in busyInterruptDrivers while attached, else -1
+	private: unsigned long phaseStart = 0;  // Value of millis() when power-up, a stage or power-down began
+	private: const std::uint8_t *sourcePixels = nullptr;  // The previous image, or null for the previous store
+	private: const std::uint8_t *targetPixels = nullptr;  // The new image, or window for UPDATE_REGION
+	private: RowSource rowSource = nullptr;  // Produces the new image instead of targetPixels if not null
+	private: void *rowContext = nullptr;
+	private: short regionX = 0;
+	private: short regionY = 0;
+	private: short regionWidth = 0;
+	private: short regionHeight = 0;
+	private: unsigned char powerAttempt = 0;  // Number of charge pump attempts so far
+	private: unsigned long pumpStart = 0;  // Value of millis() at the first charge pump write
+	private: unsigned long vcomStart = 0;  // Value of millis() at the Vcom write of the current attempt
+	private: signed char stageIndex = 0;  // Indexes Stage; always 0 for updates
+	private: short row = 0;  // Next row to draw
+	private: int frame = 0;  // Frames completed in the current stage
+	private: int stageFrames = 0;  // Frames that the current stage must draw in count mode, else 0
+	private: unsigned int stageTime = 0;  // Milliseconds that the current stage lasts in time mode, else 0
+	private: std::uint8_t changedRows[MAX_HEIGHT / 8] = {};  // Rows to drive in an update, one bit per row
+	
+	// Two buffers for encoding line writes, used alternately so that a line can be encoded
+	// into one while the other is still being sent by DMA (on cores that support it).
+	private: std::uint8_t lineBuffers[2][MAX_LINE_BYTES] = {};
+	private: unsigned char lineBufferIndex = 0;
+	
+	// The driver whose last line write is still in progress (its chip select pin is low and
+	// its output enable hasn't been written), or null. Shared because all drivers share the SPI bus.
+	private: static EpaperDriver *pendingLineDriver;
+	
+	// The drivers whose busy pin interrupt is attached, each to the handler with the same index.
+	private: static EpaperDriver *busyInterruptDrivers[BUSY_INTERRUPT_SLOTS];
+	
+	// Whether this driver has begun the SPI library for a power-on that hasn't ended yet, and the
+	// number of such drivers. SPI is begun by the first of them and ended by the last of them, so
+	// that the panels of other drivers on the bus can be refreshed at the same time.
+	private: bool spiInUse = false;
+	private: static unsigned char spiUsers;
 	
 	
 	
@@ -108,6 +385,10 @@ class EpaperDriver final {
 	public: explicit EpaperDriver(Size sz = Size::INVALID, std::uint8_t prevPix[] = nullptr);
 	
 	
+	// Creates a driver that encodes line writes with the given functions. Used by EpaperDriverT.
+	private: EpaperDriver(Size sz, std::uint8_t prevPix[], const LineCodec &codec);
+	
+	
 	
 	/*---- Drawing control methods ----*/
 	
@@ -126,16 +407,66 @@ class EpaperDriver final {
 	public: void setFrameTimeByTemperature(int tmpr);
 	
 	
+	// Sets the duration (in milliseconds) of each stage of changeImage() separately, in the order
+	// compensate, white, inverse, normal. Each must be in the range [1, 32767], otherwise nothing
+	// is changed. In time mode, each stage ends once its time is up, which may be partway through
+	// a frame, but not before one whole frame is drawn. So a stage may run longer than its time
+	// if that is shorter than a frame. updateImage() and updateRegion() use the time of the normal stage.
+	public: void setStageTimes(const unsigned short times[4]);
+	
+	
+	// Stores the duration of each stage into the given array and returns true if the driver is in
+	// time mode, otherwise returns false. This allows caching the result of setWaveformByTemperature().
+	public: bool getStageTimes(unsigned short times[4]) const;
+	
+	
+	// Sets the number of times that a frame of each stage of changeImage() is redrawn separately, in
+	// the order compensate, white, inverse, normal. Each must be in the range [1, 32767], otherwise
+	// nothing is changed. All four stages are either timed or counted, so this replaces any stage
+	// times, and setStageTimes() replaces these counts. updateImage() and updateRegion() use the
+	// count of the normal stage.
+	public: void setStageRepeats(const unsigned short repeats[4]);
+	
+	
+	// Stores the repeat count of each stage into the given array and returns true if the driver
+	// is in repeat mode, otherwise returns false.
+	public: bool getStageRepeats(unsigned short repeats[4]) const;
+	
+	
+	// Sets the waveform table used by setWaveformByTemperature(). The array must be sorted by
+	// temperature (ascending, with equal temperatures allowed to make a step), and must stay
+	// valid while it is in use because it is not copied. This allows a table calibrated for a
+	// particular panel and content, e.g. loaded from EEPROM. Null or a count outside [1, 255]
+	// selects the default table, which reproduces the steps of setFrameTimeByTemperature().
+	public: void setWaveformTable(const WaveformPoint table[], int count);
+	
+	
+	// Sets the stage times based on temperature (in degrees Celsius), by linear interpolation
+	// between the two points of the waveform table that surround the given temperature, or
+	// the first or last point if the temperature is outside the table. All input values are acceptable.
+	public: void setWaveformByTemperature(int tmpr);
+	
+	
+	// Selects how many stages changeImage() draws and for how long, from slowest with the
+	// least ghosting (FULL, the default) to fastest (FAST), which takes about as long as an
+	// updateImage() that changes every row. Does not affect updateImage() or updateRegion().
+	public: void setChangeMode(ChangeMode mode);
+	
+	
 	
 	/*---- Drawing methods ----*/
 	
+	// The methods in this section block until the refresh is finished, and are equivalent to calling
+	// the corresponding begin method and then calling poll() (with waits) until it is finished.
+	
 	// Changes the displayed image from some previous image to the given image.
 	// - If the argument prevPix is not null, then it is used
 	//   as the previous image (only read, not written).
 	// - Else if the field previousImage is not null,
 	//   then it is used as the previous image.
-	// - Otherwise with both prevPix and previousImage
-	//   being null, this method returns an error.
+	// - Else if the field previousStore is not null and valid,
+	//   then it is decoded as the previous image.
+	// - Otherwise this method returns an error.
 	// 
 	// All elements of both the previous and current image arrays must have initialized values,
 	// because the arrays will be read. (For example, it is unacceptable to allocate the previous
@@ -145,6 +476,7 @@ class EpaperDriver final {
 	// white screen, the negative of the given image, and finally the positive of the given image.
 	// If previousImage is not null (regardless of the value of prevPix), then the given
 	// image is copied to previousImage, which may be read on the next call to changeImage().
+	// Otherwise the given image is compressed into previousStore (if not null).
 	// 
 	// All image arrays follow these rules:
 	// - Array length is equal to width * height / 8, which must be an integer.
@@ -163,21 +495,79 @@ class EpaperDriver final {
 	// This method updates exactly the pixels on screen where the given image differs from the previous image,
 	// and doesn't make the whole screen flicker. But image quality may be degraded around the edges
 	// of changed pixels, so it's a good idea to use changeImage() periodically for a clean redraw.
+	// Only the rows that contain changed pixels are driven, so the frame repeats are spent on those
+	// rows alone. If no pixel changed at all, then the device isn't powered on and OK is returned.
 	public: Status updateImage(const std::uint8_t pixels[], const std::uint8_t prevPix[] = nullptr);
 	
 	
-	// Draws the given image the given number of times, mapping white pixels
-	// to the given 2-bit value and black pixels to the given 2-bit value.
-	private: void drawFrame(const std::uint8_t pixels[],
-		std::uint32_t mapWhiteTo, std::uint32_t mapBlackTo, int iterations);
+	// Updates only the given rectangular window of the screen, in the manner of updateImage().
+	// The field previousPixels (or else previousStore) must be set, because it provides the image
+	// outside the window and its window is overwritten with the new pixels. The window must be within the screen, i.e.
+	// 0 <= x, 0 <= y, x + w <= width, and y + h <= height. Zero width or height is a no-op.
+	// The source array has h rows of ceil(w / 8) bytes each, with pixel (i, j) of the window stored
+	// at byte j * ceil(w / 8) + floor(i / 8), bit i % 8 (least significant bit first). Rows of the window
+	// where no pixel changed are not driven, and no other rows are driven. If no pixel changed at all,
+	// then the device isn't powered on. Nothing values are sent for all pixels outside the window.
+	public: Status updateRegion(int x, int y, int w, int h, const std::uint8_t pixels[]);
+	
+	
+	// Like changeImage() and updateImage(), but each row of the new image is produced by the given
+	// function when the driver needs it, so that the caller needs no array for the new image.
+	// The function is called for every row that is drawn in every frame (except in the first two
+	// stages of a change, which draw the previous image), once more per row to find the changed
+	// rows of an update, and once more per row to save the image into previousPixels or previousStore.
+	// So it must produce the same pixels every time, and should be quick (e.g. a procedural pattern).
+	public: Status changeImage(RowSource source, void *context, const std::uint8_t prevPix[] = nullptr);
+	
+	public: Status updateImage(RowSource source, void *context, const std::uint8_t prevPix[] = nullptr);
+	
+	
+	// Sets the bit (y % 8) of changedRows[y / 8] if row y differs between the previous
+	// and new image, otherwise clears it, for every row. Returns the number of changed rows.
+	// The fields sourcePixels and targetPixels (or rowSource) must be set.
+	private: int findChangedRows();
+	
+	
+	// Returns the given row of the new image, which is either in targetPixels, or produced
+	// by the row source into the given array (of length at least getBytesPerLine()).
+	private: const std::uint8_t *getTargetRow(int y, std::uint8_t buf[]) const;
+	
 	
+	// Copies the new image (from targetPixels or the row source) into previousPixels,
+	// or else into the previous store, if any.
+	private: void saveTargetImage();
 	
-	// Draws the given line of pixels to the given row number, mapping white pixels
-	// to the given 2-bit value and black pixels to the given 2-bit value.
-	// Either 0 <= row < height to draw to a normal row,
-	// or row = -4 to deactivate all the row selector bytes.
-	private: void drawLine(int row, const std::uint8_t pixels[],
-		std::uint32_t mapWhiteTo, std::uint32_t mapBlackTo, std::uint8_t border);
+	
+	// Returns the given row of the previous image, which is either in sourcePixels, or
+	// decoded from the previous store (if sourcePixels is null) into the given array.
+	private: const std::uint8_t *getSourceRow(int y, std::uint8_t buf[]) const;
+	
+	
+	// Returns previousStore if it is used (previousPixels is null) and has the right dimensions, otherwise null.
+	private: CompressedImage *getPreviousStore() const;
+	
+	
+	// Returns whether a previous image is available, i.e. the given array is not null,
+	// or the previous store is used and valid.
+	private: bool hasPreviousImage(const std::uint8_t prevPix[]) const;
+	
+	
+	// Returns the lowest row number at least the given start that is marked
+	// in changedRows, or -1 if there is none.
+	private: int nextChangedRow(int start) const;
+	
+	
+	// If statistics is not null, records the given number of frames of the given
+	// stage, and the time since the given start time, into it.
+	private: void recordStage(int index, int frames, unsigned long startTime);
+	
+	
+	// Draws the given line of pixels to the given row number, mapping
+	// white and black pixels according to the given stage.
+	// Either 0 <= y < height to draw to a normal row,
+	// or y = -4 to deactivate all the row selector bytes.
+	// If the stage is NOTHING, then pixels is not read and can be null.
+	private: void drawLine(int y, const std::uint8_t pixels[], Stage stage, std::uint8_t border);
 	
 	
 	// Draws the given line of differential pixels to the given row number.
@@ -185,7 +575,154 @@ class EpaperDriver final {
 	// then the pixel value in 'pixels' is drawn, otherwise a nothing value is drawn.
 	// It is necessary to draw nothing on unchanged pixels because overdriving
 	// the pixels with the same value can cause image degradation.
-	private: void updateLine(int row, const std::uint8_t prevPix[], const std::uint8_t pixels[]);
+	private: void updateLine(int y, const std::uint8_t prevPix[], const std::uint8_t pixels[]);
+	
+	
+	// Encodes into the given buffer a complete line write (the 0x72 data header, border byte,
+	// even pixels, scan bytes and odd pixels) for the given row, except for the pixel values.
+	// The Layout type is LineLayout, or a FixedLineLayout whose constants fix the loop bounds.
+	private: template <typename Layout>
+	static void encodeLineFrame(const Layout &layout, std::uint8_t buf[], int row, std::uint8_t border);
+	
+	
+	// Encodes a complete line write for drawLine() and returns its length.
+	private: template <typename Layout>
+	static int encodeStageLine(const Layout &layout, std::uint8_t buf[], int row,
+		std::uint8_t border, const std::uint8_t pixels[], Stage stage);
+	
+	
+	// Encodes a complete line write for updateLine() and returns its length.
+	private: template <typename Layout>
+	static int encodeUpdateLine(const Layout &layout, std::uint8_t buf[], int row,
+		const std::uint8_t prevPix[], const std::uint8_t pixels[]);
+	
+	
+	// Sends the given encoded line (in the current line buffer) to the line data register, then
+	// latches it to the panel, and switches to the other line buffer. On cores with asynchronous
+	// SPI transfers, this returns while the line is still being sent, and the latching is done by
+	// the next SPI command (usually the next line's). The buffer contents may be overwritten by
+	// the SPI library, and must not be written until the transfer is finished.
+	private: void sendLine(std::uint8_t buf[], int len);
+	
+	
+	
+	/*---- Non-blocking drawing methods ----*/
+	
+	// The begin methods in this section check the arguments and start a refresh like
+	// changeImage(), updateImage() and updateRegion() respectively, but return as soon as
+	// the first step is done. The caller must then call poll() repeatedly, and may do other
+	// work in between, until poll() returns a status other than IN_PROGRESS. Each call to
+	// poll() performs at most one line write or one short sequence of commands, so that the
+	// time that poll() blocks is small (a few milliseconds at most on a slow SPI bus).
+	// 
+	// A begin method returns IN_PROGRESS if the refresh has started, OK if there is nothing to
+	// draw (in which case the device isn't powered on), BUSY if another refresh is in progress,
+	// or some other error status. The image arrays (and prevPix) must stay unchanged until the
+	// refresh is finished. The drawing control settings (frame repeats or time) must not change
+	// during a refresh. In time mode, time spent by the caller between polls counts towards
+	// the frame time, so the number of frames drawn is smaller if polls are infrequent.
+	// 
+	// On cores with asynchronous SPI transfers, poll() can return while the DMA is still sending
+	// a line to the panel, with the panel's chip select low. So while a refresh is IN_PROGRESS,
+	// the other work must not use the SPI bus (e.g. for a sensor) unless it first calls
+	// finishPendingLine(), which releases the bus. The next poll() continues normally.
+	// 
+	// Example usage pseudocode:
+	//   Status st = epd.beginChange(image);
+	//   while (st == Status::IN_PROGRESS) {
+	//     (... render the next image into another buffer, or do other work ...)
+	//     st = epd.poll();
+	//   }
+	
+	public: Status beginChange(const std::uint8_t pixels[], const std::uint8_t prevPix[] = nullptr);
+	
+	
+	public: Status beginUpdate(const std::uint8_t pixels[], const std::uint8_t prevPix[] = nullptr);
+	
+	
+	// The row source must stay valid until the refresh is finished.
+	public: Status beginChange(RowSource source, void *context, const std::uint8_t prevPix[] = nullptr);
+	
+	public: Status beginUpdate(RowSource source, void *context, const std::uint8_t prevPix[] = nullptr);
+	
+	
+	public: Status beginUpdateRegion(int x, int y, int w, int h, const std::uint8_t pixels[]);
+	
+	
+	// Advances the refresh in progress by one step if its wait has elapsed, and returns
+	// IN_PROGRESS if it isn't finished yet. Otherwise returns the final status of the
+	// last refresh (OK or an error), which is also returned by further calls. A begin
+	// method that returns anything other than IN_PROGRESS or BUSY sets this status too.
+	public: Status poll();
+	
+	
+	// Returns the number of milliseconds until the next call to poll() can make progress,
+	// which is 0 if it can make progress now or no refresh is in progress. A caller with
+	// nothing else to do can sleep for this long without slowing down the refresh.
+	public: unsigned long getWaitTime() const;
+	
+	
+	// If a line write started by any driver's poll() is still being sent asynchronously, waits for
+	// it to finish and latches it, leaving the SPI bus free for other devices. Otherwise does nothing.
+	public: static void finishPendingLine();
+	
+	
+	// Calls poll() until the refresh finishes, sleeping with idleHook (or delay()) for
+	// the waits, and returns its final status. If the given status isn't IN_PROGRESS, returns it.
+	private: Status finishRefresh(Status st);
+	
+	
+	// Checks the pin configuration and settings, and starts the refresh described by the operation
+	// and pixel fields by powering on the device, or by drawing if a session is open.
+	// Returns like beginChange().
+	private: Status startRefresh();
+	
+	
+	// Finds the changed rows of an update whose pixel fields are set, and starts it with startRefresh(),
+	// or returns OK after saving the new image (without powering on) if no row changed.
+	private: Status startUpdate();
+	
+	
+	// Makes the given step the next one to perform, after waiting the given number of milliseconds.
+	// Detaches the busy pin interrupt if the next step isn't WAIT_IDLE.
+	private: void goToStep(Step next, unsigned int wait = 0);
+	
+	
+	// Sets up the first stage (or the update frames) and goes to the DRAW step.
+	// For the SESSION operation, opens the session and finishes the refresh instead.
+	private: void startDrawing();
+	
+	
+	// Starts the given stage of a change (or stage 0 of an update) at the current time.
+	private: void startStage(int index);
+	
+	
+	// Returns the frame repeat value of the given stage, adjusted for the operation and the change mode.
+	private: short stageRepeat(int index) const;
+	
+	
+	// Draws one line of the current stage or update frame, and moves to the next stage, or saves
+	// the previous image and goes to the power-down steps (or finishes if a session is open)
+	// after the last frame.
+	private: void drawStep();
+	
+	
+	
+	/*---- Session methods ----*/
+	
+	// Powers on the device and keeps it on, so that the following refreshes (by any of the drawing
+	// methods, blocking or not) skip the power-up and power-down sequences and start drawing
+	// immediately. This greatly reduces the latency of a burst of updates, e.g. an animation.
+	// Blocks until the device is on, and returns OK, or an error status (in which case the
+	// device is powered off and no session is open). Returns OK if a session is already open,
+	// or BUSY if a refresh is in progress. Each session must be ended by endSession().
+	// The device should not be kept on for long periods without drawing.
+	public: Status beginSession();
+	
+	
+	// Writes the nothing frame and dummy line, then powers off the device, blocking until done.
+	// Returns OK (also if no session is open), or BUSY if a refresh is in progress.
+	public: Status endSession();
 	
 	
 	
@@ -209,20 +746,34 @@ class EpaperDriver final {
 	
 	/*---- Power methods ----*/
 	
-	// Powers on the G2 COG driver, followed by initialization.
-	private: Status powerOn();
+	// Performs the current step of powering on and initializing the G2 COG driver.
+	private: void powerOnStep();
+	
+	
+	// Initializes the G2 COG driver, which is the INIT step.
+	private: void powerInit();
+	
 	
+	// Attaches a falling edge interrupt on the busy pin that sets busyPinFell, taking a free slot
+	// in busyInterruptDrivers. Does nothing if every slot is taken (busyInterruptSlot stays -1).
+	private: void attachBusyInterrupt();
 	
-	// Initializes the G2 COG driver.
-	private: Status powerInit();
 	
+	// Detaches the busy pin interrupt and frees its slot, if attached.
+	private: void detachBusyInterrupt();
 	
-	// Writes a nothing frame and dummy line, followed by power-off.
-	private: void powerFinish();
 	
+	// The interrupt handler for the driver in slot I of busyInterruptDrivers.
+	private: template <int I> static void busyPinInterrupt();
 	
-	// Powers off the G2 COG driver.
-	private: void powerOff();
+	
+	// Performs the current step of writing a nothing frame and dummy line,
+	// followed by powering off the G2 COG driver.
+	private: void powerOffStep();
+	
+	
+	// Ends the refresh early with the given error status, by powering off the G2 COG driver.
+	private: void failRefresh(Status st);
 	
 	
 	
@@ -233,6 +784,10 @@ class EpaperDriver final {
 	private: void spiWrite(std::uint8_t cmdIndex, std::uint8_t cmdData);
 	
 	
+	// Sends the given number of one-byte register writes, each being an (index, data) pair.
+	private: void spiWriteList(const std::uint8_t cmds[][2], int count);
+	
+	
 	// Sends a command over SPI to the device, containing exactly one dummy byte,
 	// reading the one-byte response, and returning it. This cannot
 	// be used for reads that contain less or more than one data byte.
@@ -248,4 +803,60 @@ class EpaperDriver final {
 	// the latter byte transfer, and holding the chip select pin low during the transfers.
 	private: std::uint8_t spiRawPair(std::uint8_t b0, std::uint8_t b1);
 	
+	
+	// Sends the given bytes over SPI with as few gaps between bytes as the core allows,
+	// ignoring the response. The chip select pin must already be low. Depending on
+	// the SPI library, the array contents may be overwritten by the received bytes.
+	private: void spiWriteBlock(std::uint8_t data[], int len);
+	
+	
+	// Starts sending the given bytes of a line write like spiWriteBlock(), but on cores with
+	// asynchronous SPI transfers (DMA), returns before the transfer is finished. The chip select
+	// pin must already be low, and pendingLineDriver must be set to this driver.
+	private: void spiStartLine(std::uint8_t data[], int len);
+	
 };
+
+
+
+/* 
+ * A driver for the panel size S that is fixed at compile time. The line encoders are
+ * instantiated for that size only, so their loop bounds and byte positions are constants,
+ * and (when linking with unused sections removed, as Arduino does) the encoders of
+ * other sizes are left out of the program. Apart from construction, it is used exactly
+ * like EpaperDriver, and its size field must not be changed (drawing returns INTERNAL_ERROR).
+ * 
+ * Sample usage:
+ *   uint8_t prevImage[EpaperDriverT<EpaperDriver::Size::EPD_2_71_INCH>::IMAGE_BYTES] = {};
+ *   EpaperDriverT<EpaperDriver::Size::EPD_2_71_INCH> epd(prevImage);
+ */
+template <EpaperDriver::Size S>
+class EpaperDriverT final : public EpaperDriver {
+	
+	static_assert(widthOf(S) != -1, "Invalid panel size");
+	
+	
+	/*---- Constants ----*/
+	
+	// The values of getWidth(), getHeight() and getBytesPerLine() as constant expressions,
+	// and the length of an image array in bytes.
+	public: static constexpr int WIDTH = widthOf(S);
+	public: static constexpr int HEIGHT = heightOf(S);
+	public: static constexpr int BYTES_PER_LINE = WIDTH / 8;
+	public: static constexpr int IMAGE_BYTES = BYTES_PER_LINE * HEIGHT;
+	
+	
+	/*---- Constructor ----*/
+	
+	// Creates a driver with the given previous image array (can be null).
+	// This constructor doesn't perform any I/O or modify hardware configuration.
+	public: explicit EpaperDriverT(std::uint8_t prevPix[] = nullptr) :
+		EpaperDriver(S, prevPix, FixedLineLayout<S>::CODEC) {}
+		
+};
+
+
+template <EpaperDriver::Size S> constexpr int EpaperDriverT<S>::WIDTH;
+template <EpaperDriver::Size S> constexpr int EpaperDriverT<S>::HEIGHT;
+template <EpaperDriver::Size S> constexpr int EpaperDriverT<S>::BYTES_PER_LINE;
+template <EpaperDriver::Size S> constexpr int EpaperDriverT<S>::IMAGE_BYTES;
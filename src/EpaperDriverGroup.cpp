@@ -0,0 +1,151 @@
+/* 
+ * Hardware driver for Pervasive Displays' e-paper panels
+ * 
+ * Copyright (c) Project Nayuki. (MIT License)
+ * https://www.nayuki.io/page/pervasive-displays-epaper-panel-hardware-driver
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * - The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ * - The Software is provided "as is", without warranty of any kind, express or
+ *   implied, including but not limited to the warranties of merchantability,
+ *   fitness for a particular purpose and noninfringement. In no event shall the
+ *   authors or copyright holders be liable for any claim, damages or other
+ *   liability, whether in an action of contract, tort or otherwise, arising from,
+ *   out of or in connection with the Software or the use or other dealings in the
+ *   Software.
+ */
+
+#include <Arduino.h>
+#include "EpaperDriverGroup.hpp"
+
+using std::uint8_t;
+using Status = EpaperDriverGroup::Status;
+
+
+
+/*---- Constructor ----*/
+
+EpaperDriverGroup::EpaperDriverGroup(EpaperDriver *const drv[], int n) :
+		drivers(drv),
+		count(1 <= n && n <= MAX_DRIVERS ? n : 0) {
+	for (Status &st : statuses)
+		st = Status::OK;
+}
+
+
+
+/*---- Drawing methods ----*/
+
+Status EpaperDriverGroup::changeImages(const uint8_t *const images[]) {
+	return finishRefreshes(beginChange(images));
+}
+
+
+Status EpaperDriverGroup::updateImages(const uint8_t *const images[]) {
+	return finishRefreshes(beginUpdate(images));
+}
+
+
+
+/*---- Non-blocking drawing methods ----*/
+
+Status EpaperDriverGroup::beginChange(const uint8_t *const images[]) {
+	if (getGroupStatus() == Status::IN_PROGRESS)
+		return Status::BUSY;
+	if (count == 0)
+		return Status::INVALID_ARGUMENT;
+	// Every driver does its first step before any other driver's wait has elapsed,
+	// so all the power-up sequences run at the same time
+	for (int i = 0; i < count; i++)
+		statuses[i] = images[i] != nullptr ? drivers[i]->beginChange(images[i]) : Status::OK;
+	return getGroupStatus();
+}
+
+
+Status EpaperDriverGroup::beginUpdate(const uint8_t *const images[]) {
+	if (getGroupStatus() == Status::IN_PROGRESS)
+		return Status::BUSY;
+	if (count == 0)
+		return Status::INVALID_ARGUMENT;
+	for (int i = 0; i < count; i++)
+		statuses[i] = images[i] != nullptr ? drivers[i]->beginUpdate(images[i]) : Status::OK;
+	return getGroupStatus();
+}
+
+
+Status EpaperDriverGroup::track(int index, Status st) {
+	if (index < 0 || index >= count)
+		return Status::INVALID_ARGUMENT;
+	if (statuses[index] != Status::IN_PROGRESS)
+		statuses[index] = st;
+	return st;
+}
+
+
+Status EpaperDriverGroup::poll() {
+	for (int i = 0; i < count; i++) {
+		if (statuses[i] == Status::IN_PROGRESS)
+			statuses[i] = drivers[i]->poll();
+	}
+	return getGroupStatus();
+}
+
+
+unsigned long EpaperDriverGroup::getWaitTime() const {
+	unsigned long result = 0;
+	bool any = false;
+	for (int i = 0; i < count; i++) {
+		if (statuses[i] != Status::IN_PROGRESS)
+			continue;
+		unsigned long wait = drivers[i]->getWaitTime();
+		if (!any || wait < result)
+			result = wait;
+		any = true;
+	}
+	return result;
+}
+
+
+int EpaperDriverGroup::getCount() const {
+	return count;
+}
+
+
+Status EpaperDriverGroup::getStatus(int index) const {
+	if (index < 0 || index >= count)
+		return Status::INVALID_ARGUMENT;
+	return statuses[index];
+}
+
+
+Status EpaperDriverGroup::finishRefreshes(Status st) {
+	while (st == Status::IN_PROGRESS) {
+		unsigned long wait = getWaitTime();
+		if (wait > 0) {
+			if (idleHook != nullptr)
+				idleHook(wait);
+			else
+				delay(wait);
+		}
+		st = poll();
+	}
+	return st;
+}
+
+
+Status EpaperDriverGroup::getGroupStatus() const {
+	Status result = Status::OK;
+	for (int i = 0; i < count; i++) {
+		if (statuses[i] == Status::IN_PROGRESS)
+			return Status::IN_PROGRESS;
+		if (result == Status::OK)
+			result = statuses[i];
+	}
+	return result;
+}
@@ -0,0 +1,143 @@
+/* 
+ * Hardware driver for Pervasive Displays' e-paper panels
+ * 
+ * Copyright (c) Project Nayuki. (MIT License)
+ * https://www.nayuki.io/page/pervasive-displays-epaper-panel-hardware-driver
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * - The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ * - The Software is provided "as is", without warranty of any kind, express or
+ *   implied, including but not limited to the warranties of merchantability,
+ *   fitness for a particular purpose and noninfringement. In no event shall the
+ *   authors or copyright holders be liable for any claim, damages or other
+ *   liability, whether in an action of contract, tort or otherwise, arising from,
+ *   out of or in connection with the Software or the use or other dealings in the
+ *   Software.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "EpaperDriver.hpp"
+
+
+/* 
+ * Refreshes several e-paper panels on one SPI bus at the same time. Each panel has its
+ * own EpaperDriver with its own pins (only the SPI bus pins are shared). The refreshes
+ * are advanced in turn through the drivers' non-blocking methods, so that the waits of
+ * one panel (power-up, charge pump settling, power-down and discharge) overlap with the
+ * waits and line writes of the others, and the SPI bus is idle only if every panel waits.
+ * 
+ * With frame repeat counts, the total time is close to one panel's refresh plus the bus
+ * time of the other panels' lines. With a frame time, the total time is close to one
+ * panel's refresh, but the panels share the bus during the stages, so each draws fewer frames.
+ * 
+ * Sample usage:
+ *   EpaperDriver epd0(Size::EPD_2_71_INCH, prevImage0);
+ *   EpaperDriver epd1(Size::EPD_2_00_INCH, prevImage1);
+ *   (... assign the pins of each driver, with a different chip select pin for each ...)
+ *   EpaperDriver *drivers[] = {&epd0, &epd1};
+ *   EpaperDriverGroup group(drivers, 2);
+ *   const uint8_t *images[] = {image0, image1};
+ *   Status st = group.changeImages(images);
+ */
+class EpaperDriverGroup final {
+	
+	public: using Status = EpaperDriver::Status;
+	
+	
+	/*---- Fields ----*/
+	
+	public: static constexpr int MAX_DRIVERS = 8;
+	
+	// Called instead of delay() when every panel in the group is waiting, with the number of
+	// milliseconds until the next one can make progress. Can be null. See EpaperDriver::idleHook.
+	public: void (*idleHook)(unsigned long millis) = nullptr;
+	
+	private: EpaperDriver *const *drivers;
+	private: int count;
+	private: Status statuses[MAX_DRIVERS];  // Of the last refresh of each driver
+	
+	
+	
+	/*---- Constructor ----*/
+	
+	// Creates a group of the given drivers, where the count must be in the range [1, MAX_DRIVERS].
+	// Otherwise the group is empty (getCount() returns 0) and every drawing method returns
+	// INVALID_ARGUMENT. The array must stay valid while this object is used. This constructor
+	// doesn't perform any I/O.
+	public: EpaperDriverGroup(EpaperDriver *const drv[], int n);
+	
+	
+	
+	/*---- Drawing methods ----*/
+	
+	// Changes the image of each panel i to images[i], like EpaperDriver::changeImage() with the
+	// previous image in the driver's previousPixels (or previousStore). A null entry leaves that
+	// panel alone. Blocks until every refresh is finished, and returns OK if they all succeeded,
+	// or else the status of the first panel that failed (see getStatus() for each panel).
+	public: Status changeImages(const std::uint8_t *const images[]);
+	
+	
+	// Updates the image of each panel like EpaperDriver::updateImage(), otherwise like changeImages().
+	public: Status updateImages(const std::uint8_t *const images[]);
+	
+	
+	
+	/*---- Non-blocking drawing methods ----*/
+	
+	// Starts the refreshes of changeImages() and updateImages() respectively, and returns IN_PROGRESS
+	// if any of them is in progress, or the final status like those methods if none is. Returns BUSY
+	// without starting anything if a refresh in the group is still in progress, or INVALID_ARGUMENT
+	// if the group is empty. The caller must then call poll() until it returns a status other than
+	// IN_PROGRESS, like with EpaperDriver::poll() (including its rule to call
+	// EpaperDriver::finishPendingLine() before other SPI use in between).
+	public: Status beginChange(const std::uint8_t *const images[]);
+	
+	public: Status beginUpdate(const std::uint8_t *const images[]);
+	
+	
+	// Records the status returned by a begin method that was called directly on the driver at the
+	// given index (e.g. beginUpdateRegion(), or a row source), so that poll() advances that refresh
+	// along with the others. Returns the given status, or INVALID_ARGUMENT if the index is not in
+	// the range [0, getCount()). If that driver's refresh is already in progress (so the given
+	// status is BUSY), its status isn't changed.
+	public: Status track(int index, Status st);
+	
+	
+	// Calls poll() once on each driver whose refresh is in progress, which advances the ones whose
+	// wait has elapsed. Returns IN_PROGRESS if any refresh isn't finished yet, otherwise OK if every
+	// refresh succeeded, or else the status of the first panel that failed.
+	public: Status poll();
+	
+	
+	// Returns the number of milliseconds until the next call to poll() can make progress,
+	// which is the smallest wait of the refreshes in progress, or 0 if none is in progress.
+	public: unsigned long getWaitTime() const;
+	
+	
+	// Returns the number of drivers in the group, which is 0 if the constructor's count was out of range.
+	public: int getCount() const;
+	
+	
+	// Returns the status of the last refresh of the panel at the given index: IN_PROGRESS, or its
+	// final status, or OK if it wasn't refreshed by the last call that started refreshes.
+	// Returns INVALID_ARGUMENT if the index is not in the range [0, getCount()).
+	public: Status getStatus(int index) const;
+	
+	
+	// Calls poll() until every refresh finishes, sleeping with idleHook (or delay()) when all of
+	// them wait, and returns the final status. If the given status isn't IN_PROGRESS, returns it.
+	private: Status finishRefreshes(Status st);
+	
+	
+	// Returns the status that poll() returns, from the statuses of the drivers.
+	private: Status getGroupStatus() const;
+	
+};
@@ -0,0 +1,155 @@
+/* 
+ * Hardware driver for Pervasive Displays' e-paper panels
+ * 
+ * Copyright (c) Project Nayuki. (MIT License)
+ * https://www.nayuki.io/page/pervasive-displays-epaper-panel-hardware-driver
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * - The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ * - The Software is provided "as is", without warranty of any kind, express or
+ *   implied, including but not limited to the warranties of merchantability,
+ *   fitness for a particular purpose and noninfringement. In no event shall the
+ *   authors or copyright holders be liable for any claim, damages or other
+ *   liability, whether in an action of contract, tort or otherwise, arising from,
+ *   out of or in connection with the Software or the use or other dealings in the
+ *   Software.
+ */
+
+#include "Font.hpp"
+
+using std::uint8_t;
+using BlitMode = Canvas::BlitMode;
+
+
+// One byte per glyph row, with the leftmost pixel in the lowest bit. Each glyph
+// is 5*7 pixels in the top left corner of its 6*8 cell.
+static const uint8_t STANDARD_ATLAS[] = {
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // ' '
+	0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04, 0x00,  // '!'
+	0x0A, 0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00,  // '"'
+	0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A, 0x00,  // '#'
+	0x04, 0x1E, 0x05, 0x0E, 0x14, 0x0F, 0x04, 0x00,  // '$'
+	0x03, 0x13, 0x08, 0x04, 0x02, 0x19, 0x18, 0x00,  // '%'
+	0x06, 0x09, 0x05, 0x02, 0x15, 0x09, 0x16, 0x00,  // '&'
+	0x04, 0x04, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00,  // '\''
+	0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08, 0x00,  // '('
+	0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02, 0x00,  // ')'
+	0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00, 0x00,  // '*'
+	0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00, 0x00,  // '+'
+	0x00, 0x00, 0x00, 0x00, 0x06, 0x04, 0x02, 0x00,  // ','
+	0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00, 0x00,  // '-'
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x06, 0x06, 0x00,  // '.'
+	0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00, 0x00,  // '/'
+	0x0E, 0x11, 0x19, 0x15, 0x13, 0x11, 0x0E, 0x00,  // '0'
+	0x04, 0x06, 0x04, 0x04, 0x04, 0x04, 0x0E, 0x00,  // '1'
+	0x0E, 0x11, 0x10, 0x08, 0x04, 0x02, 0x1F, 0x00,  // '2'
+	0x1F, 0x08, 0x04, 0x08, 0x10, 0x11, 0x0E, 0x00,  // '3'
+	0x08, 0x0C, 0x0A, 0x09, 0x1F, 0x08, 0x08, 0x00,  // '4'
+	0x1F, 0x01, 0x0F, 0x10, 0x10, 0x11, 0x0E, 0x00,  // '5'
+	0x0C, 0x02, 0x01, 0x0F, 0x11, 0x11, 0x0E, 0x00,  // '6'
+	0x1F, 0x10, 0x08, 0x04, 0x02, 0x02, 0x02, 0x00,  // '7'
+	0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E, 0x00,  // '8'
+	0x0E, 0x11, 0x11, 0x1E, 0x10, 0x08, 0x06, 0x00,  // '9'
+	0x00, 0x06, 0x06, 0x00, 0x06, 0x06, 0x00, 0x00,  // ':'
+	0x00, 0x06, 0x06, 0x00, 0x06, 0x04, 0x02, 0x00,  // ';'
+	0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08, 0x00,  // '<'
+	0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00, 0x00,  // '='
+	0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02, 0x00,  // '>'
+	0x0E, 0x11, 0x10, 0x08, 0x04, 0x00, 0x04, 0x00,  // '?'
+	0x0E, 0x11, 0x10, 0x16, 0x15, 0x15, 0x0E, 0x00,  // '@'
+	0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11, 0x00,  // 'A'
+	0x0F, 0x11, 0x11, 0x0F, 0x11, 0x11, 0x0F, 0x00,  // 'B'
+	0x0E, 0x11, 0x01, 0x01, 0x01, 0x11, 0x0E, 0x00,  // 'C'
+	0x07, 0x09, 0x11, 0x11, 0x11, 0x09, 0x07, 0x00,  // 'D'
+	0x1F, 0x01, 0x01, 0x0F, 0x01, 0x01, 0x1F, 0x00,  // 'E'
+	0x1F, 0x01, 0x01, 0x0F, 0x01, 0x01, 0x01, 0x00,  // 'F'
+	0x0E, 0x11, 0x01, 0x1D, 0x11, 0x11, 0x1E, 0x00,  // 'G'
+	0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11, 0x00,  // 'H'
+	0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E, 0x00,  // 'I'
+	0x1C, 0x08, 0x08, 0x08, 0x08, 0x09, 0x06, 0x00,  // 'J'
+	0x11, 0x09, 0x05, 0x03, 0x05, 0x09, 0x11, 0x00,  // 'K'
+	0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x1F, 0x00,  // 'L'
+	0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11, 0x00,  // 'M'
+	0x11, 0x11, 0x13, 0x15, 0x19, 0x11, 0x11, 0x00,  // 'N'
+	0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E, 0x00,  // 'O'
+	0x0F, 0x11, 0x11, 0x0F, 0x01, 0x01, 0x01, 0x00,  // 'P'
+	0x0E, 0x11, 0x11, 0x11, 0x15, 0x09, 0x16, 0x00,  // 'Q'
+	0x0F, 0x11, 0x11, 0x0F, 0x05, 0x09, 0x11, 0x00,  // 'R'
+	0x1E, 0x01, 0x01, 0x0E, 0x10, 0x10, 0x0F, 0x00,  // 'S'
+	0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x00,  // 'T'
+	0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E, 0x00,  // 'U'
+	0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04, 0x00,  // 'V'
+	0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A, 0x00,  // 'W'
+	0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11, 0x00,  // 'X'
+	0x11, 0x11, 0x0A, 0x04, 0x04, 0x04, 0x04, 0x00,  // 'Y'
+	0x1F, 0x10, 0x08, 0x04, 0x02, 0x01, 0x1F, 0x00,  // 'Z'
+	0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E, 0x00,  // '['
+	0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00, 0x00,  // '\\'
+	0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E, 0x00,  // ']'
+	0x04, 0x0A, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00,  // '^'
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x00,  // '_'
+	0x02, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00,  // '`'
+	0x00, 0x00, 0x0E, 0x10, 0x1E, 0x11, 0x1E, 0x00,  // 'a'
+	0x01, 0x01, 0x0D, 0x13, 0x11, 0x11, 0x0F, 0x00,  // 'b'
+	0x00, 0x00, 0x0E, 0x01, 0x01, 0x11, 0x0E, 0x00,  // 'c'
+	0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x1E, 0x00,  // 'd'
+	0x00, 0x00, 0x0E, 0x11, 0x1F, 0x01, 0x0E, 0x00,  // 'e'
+	0x0C, 0x12, 0x02, 0x07, 0x02, 0x02, 0x02, 0x00,  // 'f'
+	0x00, 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x0E, 0x00,  // 'g'
+	0x01, 0x01, 0x0D, 0x13, 0x11, 0x11, 0x11, 0x00,  // 'h'
+	0x04, 0x00, 0x06, 0x04, 0x04, 0x04, 0x0E, 0x00,  // 'i'
+	0x08, 0x00, 0x0C, 0x08, 0x08, 0x09, 0x06, 0x00,  // 'j'
+	0x01, 0x01, 0x09, 0x05, 0x03, 0x05, 0x09, 0x00,  // 'k'
+	0x06, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E, 0x00,  // 'l'
+	0x00, 0x00, 0x0B, 0x15, 0x15, 0x11, 0x11, 0x00,  // 'm'
+	0x00, 0x00, 0x0D, 0x13, 0x11, 0x11, 0x11, 0x00,  // 'n'
+	0x00, 0x00, 0x0E, 0x11, 0x11, 0x11, 0x0E, 0x00,  // 'o'
+	0x00, 0x00, 0x0F, 0x11, 0x0F, 0x01, 0x01, 0x00,  // 'p'
+	0x00, 0x00, 0x16, 0x19, 0x1E, 0x10, 0x10, 0x00,  // 'q'
+	0x00, 0x00, 0x0D, 0x13, 0x01, 0x01, 0x01, 0x00,  // 'r'
+	0x00, 0x00, 0x0E, 0x01, 0x0E, 0x10, 0x0F, 0x00,  // 's'
+	0x02, 0x02, 0x07, 0x02, 0x02, 0x12, 0x0C, 0x00,  // 't'
+	0x00, 0x00, 0x11, 0x11, 0x11, 0x19, 0x16, 0x00,  // 'u'
+	0x00, 0x00, 0x11, 0x11, 0x11, 0x0A, 0x04, 0x00,  // 'v'
+	0x00, 0x00, 0x11, 0x11, 0x15, 0x15, 0x0A, 0x00,  // 'w'
+	0x00, 0x00, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x00,  // 'x'
+	0x00, 0x00, 0x11, 0x11, 0x1E, 0x10, 0x0E, 0x00,  // 'y'
+	0x00, 0x00, 0x1F, 0x08, 0x04, 0x02, 0x1F, 0x00,  // 'z'
+	0x08, 0x04, 0x04, 0x02, 0x04, 0x04, 0x08, 0x00,  // '{'
+	0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x00,  // '|'
+	0x02, 0x04, 0x04, 0x08, 0x04, 0x04, 0x02, 0x00,  // '}'
+	0x00, 0x00, 0x02, 0x15, 0x08, 0x00, 0x00, 0x00,  // '~'
+};
+
+const Font Font::STANDARD(STANDARD_ATLAS, 1, 6, 8, ' ', 95);
+
+
+
+/*---- Methods ----*/
+
+bool Font::hasGlyph(char c) const {
+	int i = static_cast<unsigned char>(c) - static_cast<unsigned char>(first);
+	return 0 <= i && i < count;
+}
+
+
+void Font::drawChar(Canvas &canvas, int x, int y, char c, BlitMode mode) const {
+	if (hasGlyph(c)) {
+		int i = static_cast<unsigned char>(c) - static_cast<unsigned char>(first);
+		canvas.blit(x, y, atlas, stride, 0, i * height, width, height, mode);
+	} else if (mode == BlitMode::COPY)
+		canvas.fillRect(x, y, width, height, Canvas::Ink::WHITE);
+}
+
+
+int Font::drawText(Canvas &canvas, int x, int y, const char *text, BlitMode mode) const {
+	for (; *text != '\0'; text++, x += width)
+		drawChar(canvas, x, y, *text, mode);
+	return x;
+}
@@ -0,0 +1,82 @@
+/* 
+ * Hardware driver for Pervasive Displays' e-paper panels
+ * 
+ * Copyright (c) Project Nayuki. (MIT License)
+ * https://www.nayuki.io/page/pervasive-displays-epaper-panel-hardware-driver
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * - The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ * - The Software is provided "as is", without warranty of any kind, express or
+ *   implied, including but not limited to the warranties of merchantability,
+ *   fitness for a particular purpose and noninfringement. In no event shall the
+ *   authors or copyright holders be liable for any claim, damages or other
+ *   liability, whether in an action of contract, tort or otherwise, arising from,
+ *   out of or in connection with the Software or the use or other dealings in the
+ *   Software.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "Canvas.hpp"
+
+
+/* 
+ * A monospaced bitmap font whose glyphs are stored in an atlas: a bitmap in the driver's
+ * pixel format (least significant bit first) with a row stride of any number of bytes, where
+ * the glyph of character first + i occupies rows [i * height, (i + 1) * height) and columns
+ * [0, width). Each glyph includes the spacing to the next character and line, so text is drawn
+ * by blitting whole glyph cells next to each other, one shifted row of bytes at a time.
+ * 
+ * Sample usage:
+ *   Canvas canvas(image, 264, 176);
+ *   Font::STANDARD.drawText(canvas, 0, 0, "Hello");
+ */
+class Font final {
+	
+	/*---- Fields ----*/
+	
+	public: const std::uint8_t *atlas;
+	public: int stride;  // Bytes per atlas row
+	public: int width;   // Pixels per character cell, in the range [1, stride * 8]
+	public: int height;  // Pixels per character cell
+	public: char first;  // Character of the first glyph
+	public: int count;   // Number of glyphs
+	
+	// A 6*8 font of the printable ASCII characters (0x20 to 0x7E), with 5*7 glyphs.
+	public: static const Font STANDARD;
+	
+	
+	
+	/*---- Constructor ----*/
+	
+	public: constexpr Font(const std::uint8_t *atl, int strd, int w, int h, char fst, int n) :
+		atlas(atl), stride(strd), width(w), height(h), first(fst), count(n) {}
+	
+	
+	
+	/*---- Methods ----*/
+	
+	// Returns whether the font has a glyph for the given character.
+	public: bool hasGlyph(char c) const;
+	
+	
+	// Draws the cell of the given character with its top left corner at (x, y), clipped to the
+	// canvas. With BlitMode::COPY the whole cell is drawn, so it replaces what was there before.
+	// A character without a glyph is drawn as a white cell (or not at all, in the other modes).
+	public: void drawChar(Canvas &canvas, int x, int y, char c,
+		Canvas::BlitMode mode = Canvas::BlitMode::COPY) const;
+	
+	
+	// Draws the given null-terminated string on one line starting at (x, y), and returns
+	// the x coordinate after the last cell. Control characters are drawn like drawChar().
+	public: int drawText(Canvas &canvas, int x, int y, const char *text,
+		Canvas::BlitMode mode = Canvas::BlitMode::COPY) const;
+		
+};
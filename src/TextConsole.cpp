@@ -0,0 +1,227 @@
+/* 
+ * Hardware driver for Pervasive Displays' e-paper panels
+ * 
+ * Copyright (c) Project Nayuki. (MIT License)
+ * https://www.nayuki.io/page/pervasive-displays-epaper-panel-hardware-driver
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * - The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ * - The Software is provided "as is", without warranty of any kind, express or
+ *   implied, including but not limited to the warranties of merchantability,
+ *   fitness for a particular purpose and noninfringement. In no event shall the
+ *   authors or copyright holders be liable for any claim, damages or other
+ *   liability, whether in an action of contract, tort or otherwise, arising from,
+ *   out of or in connection with the Software or the use or other dealings in the
+ *   Software.
+ */
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include "TextConsole.hpp"
+
+using std::uint8_t;
+using Status = EpaperDriver::Status;
+
+
+
+/*---- Constructor ----*/
+
+TextConsole::TextConsole(Canvas &cnv, const Font &fnt) :
+		canvas(cnv),
+		font(fnt),
+		columns(cnv.getWidth() / fnt.width),
+		lines(cnv.getHeight() / fnt.height) {
+	if (columns > 255)
+		columns = 255;
+	if (lines > MAX_LINES)
+		lines = MAX_LINES;
+	if (columns == 0 || lines == 0) {  // Not even one cell fits, so nothing is ever drawn
+		columns = 0;
+		lines = 0;
+	}
+}
+
+
+
+/*---- Output methods ----*/
+
+int TextConsole::getColumns() const {
+	return columns;
+}
+
+
+int TextConsole::getLines() const {
+	return lines;
+}
+
+
+int TextConsole::getCursorColumn() const {
+	return cursorColumn;
+}
+
+
+int TextConsole::getCursorLine() const {
+	return cursorLine;
+}
+
+
+void TextConsole::setCursor(int column, int line) {
+	if (lines == 0)
+		return;
+	cursorColumn = column < 0 ? 0 : (column > columns ? columns : column);
+	cursorLine = line < 0 ? 0 : (line >= lines ? lines - 1 : line);
+}
+
+
+void TextConsole::clear() {
+	canvas.fillRect(0, 0, columns * font.width, lines * font.height, Canvas::Ink::WHITE);
+	cursorColumn = 0;
+	cursorLine = 0;
+	for (int i = 0; i < lines; i++) {
+		dirtyStart[i] = 0;
+		dirtyEnd[i] = static_cast<uint8_t>(columns);
+	}
+}
+
+
+void TextConsole::write(char c) {
+	if (lines == 0)
+		return;
+	switch (c) {
+		case '\n':
+			newLine();
+			break;
+		
+		case '\r':
+			cursorColumn = 0;
+			break;
+		
+		case '\t':
+			write(' ');
+			while (cursorColumn % 8 != 0 && cursorColumn < columns)
+				write(' ');
+			break;
+		
+		default:
+			// Wrap only when the next character arrives, so that a full line followed by '\n' doesn't leave an empty line
+			if (cursorColumn == columns)
+				newLine();
+			font.drawChar(canvas, cursorColumn * font.width, cursorLine * font.height, c);
+			markCell(cursorColumn, cursorLine);
+			cursorColumn++;
+			break;
+	}
+}
+
+
+void TextConsole::print(const char *text) {
+	for (; *text != '\0'; text++)
+		write(*text);
+}
+
+
+void TextConsole::printf(const char *format, ...) {
+	char buf[128];
+	std::va_list args;
+	va_start(args, format);
+	std::vsnprintf(buf, sizeof(buf), format, args);
+	va_end(args);
+	print(buf);
+}
+
+
+void TextConsole::newLine() {
+	cursorColumn = 0;
+	if (cursorLine + 1 < lines) {
+		cursorLine++;
+		return;
+	}
+	
+	// Scroll the pixel rows of the text up by one line, and clear the last line
+	int bytesPerLine = canvas.getBytesPerLine();
+	int lineBytes = font.height * bytesPerLine;
+	uint8_t *pixels = canvas.getPixels();
+	std::memmove(pixels, &pixels[lineBytes], (lines - 1) * lineBytes * sizeof(pixels[0]));
+	canvas.fillRect(0, (lines - 1) * font.height, columns * font.width, font.height, Canvas::Ink::WHITE);
+	for (int i = 0; i < lines; i++) {
+		dirtyStart[i] = 0;
+		dirtyEnd[i] = static_cast<uint8_t>(columns);
+	}
+}
+
+
+void TextConsole::markCell(int column, int line) {
+	if (dirtyStart[line] == dirtyEnd[line]) {
+		dirtyStart[line] = static_cast<uint8_t>(column);
+		dirtyEnd[line] = static_cast<uint8_t>(column + 1);
+	} else if (column < dirtyStart[line])
+		dirtyStart[line] = static_cast<uint8_t>(column);
+	else if (column >= dirtyEnd[line])
+		dirtyEnd[line] = static_cast<uint8_t>(column + 1);
+}
+
+
+
+/*---- Refresh methods ----*/
+
+bool TextConsole::isDirty() const {
+	return getDirtyBottom() > 0;
+}
+
+
+bool TextConsole::isCellDirty(int column, int line) const {
+	return 0 <= line && line < lines && dirtyStart[line] <= column && column < dirtyEnd[line];
+}
+
+
+int TextConsole::getDirtyTop() const {
+	for (int i = 0; i < lines; i++) {
+		if (dirtyStart[i] != dirtyEnd[i])
+			return i * font.height;
+	}
+	return 0;
+}
+
+
+int TextConsole::getDirtyBottom() const {
+	for (int i = lines - 1; i >= 0; i--) {
+		if (dirtyStart[i] != dirtyEnd[i])
+			return (i + 1) * font.height;
+	}
+	return 0;
+}
+
+
+void TextConsole::markClean() {
+	std::memset(dirtyStart, 0, sizeof(dirtyStart));
+	std::memset(dirtyEnd, 0, sizeof(dirtyEnd));
+}
+
+
+Status TextConsole::refresh(EpaperDriver &epd) {
+	int top = getDirtyTop();
+	int bottom = getDirtyBottom();
+	Status st = epd.updateRegion(0, top, canvas.getWidth(), bottom - top,
+		&canvas.getPixels()[top * canvas.getBytesPerLine()]);
+	if (st == Status::OK)
+		markClean();
+	return st;
+}
+
+
+Status TextConsole::beginRefresh(EpaperDriver &epd) {
+	int top = getDirtyTop();
+	int bottom = getDirtyBottom();
+	Status st = epd.beginUpdateRegion(0, top, canvas.getWidth(), bottom - top,
+		&canvas.getPixels()[top * canvas.getBytesPerLine()]);
+	if (st == Status::OK || st == Status::IN_PROGRESS)
+		markClean();
+	return st;
+}
@@ -0,0 +1,156 @@
+/* 
+ * Hardware driver for Pervasive Displays' e-paper panels
+ * 
+ * Copyright (c) Project Nayuki. (MIT License)
+ * https://www.nayuki.io/page/pervasive-displays-epaper-panel-hardware-driver
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * - The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ * - The Software is provided "as is", without warranty of any kind, express or
+ *   implied, including but not limited to the warranties of merchantability,
+ *   fitness for a particular purpose and noninfringement. In no event shall the
+ *   authors or copyright holders be liable for any claim, damages or other
+ *   liability, whether in an action of contract, tort or otherwise, arising from,
+ *   out of or in connection with the Software or the use or other dealings in the
+ *   Software.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "Canvas.hpp"
+#include "EpaperDriver.hpp"
+#include "Font.hpp"
+
+
+/* 
+ * A scrolling text terminal drawn into a canvas with a monospaced font. Characters are
+ * written at a cursor that wraps at the right edge, and a new line at the bottom scrolls the
+ * text up by one line. The console records which character cells it has drawn since the
+ * last refresh, so that a refresh only updates the pixel rows of those cells (with
+ * EpaperDriver::updateRegion()), e.g. appending a log line drives only the rows of that line.
+ * 
+ * Sample usage:
+ *   uint8_t image[264 / 8 * 176];
+ *   Canvas canvas(image, 264, 176);  // Must have the panel's dimensions
+ *   TextConsole console(canvas, Font::STANDARD);
+ *   console.clear();
+ *   epd.changeImage(image);
+ *   console.markClean();
+ *   console.printf("Sensor %d: %d\n", 1, value);
+ *   console.refresh(epd);
+ */
+class TextConsole final {
+	
+	/*---- Fields ----*/
+	
+	// The maximum number of lines, which is enough for fonts at least 4 pixels tall.
+	public: static constexpr int MAX_LINES = 44;
+	
+	private: Canvas &canvas;
+	private: const Font &font;
+	private: int columns;
+	private: int lines;
+	private: int cursorColumn = 0;
+	private: int cursorLine = 0;
+	
+	// The cells of line i in the columns [dirtyStart[i], dirtyEnd[i]) were drawn since the last refresh.
+	private: std::uint8_t dirtyStart[MAX_LINES] = {};
+	private: std::uint8_t dirtyEnd[MAX_LINES] = {};
+	
+	
+	
+	/*---- Constructor ----*/
+	
+	// Creates a console that covers the given canvas with as many whole character cells
+	// of the given font as fit (at most 255 columns and MAX_LINES lines). If not even one cell
+	// fits, then the console has no columns and no lines, and writing to it does nothing.
+	// Both objects must stay valid while this object is used. This constructor doesn't draw anything.
+	public: TextConsole(Canvas &cnv, const Font &fnt);
+	
+	
+	
+	/*---- Output methods ----*/
+	
+	public: int getColumns() const;
+	
+	public: int getLines() const;
+	
+	public: int getCursorColumn() const;
+	
+	public: int getCursorLine() const;
+	
+	
+	// Moves the cursor to the given cell, clamping it to the console.
+	public: void setCursor(int column, int line);
+	
+	
+	// Clears the console area to white, moves the cursor to the top left, and marks every cell as drawn.
+	public: void clear();
+	
+	
+	// Writes the given character at the cursor and advances the cursor, wrapping to the
+	// next line after the last column. '\n' moves to the start of the next line, '\r' moves
+	// to the start of the line, and '\t' advances to the next multiple of 8 columns.
+	// A new line below the last line scrolls the text up and marks every cell as drawn.
+	public: void write(char c);
+	
+	
+	// Writes the characters of the given null-terminated string.
+	public: void print(const char *text);
+	
+	
+	// Formats the arguments like std::printf() and writes up to 127 characters of the result.
+	public: void printf(const char *format, ...);
+	
+	
+	
+	/*---- Refresh methods ----*/
+	
+	// Returns whether any cell was drawn since the last refresh (or markClean()).
+	public: bool isDirty() const;
+	
+	
+	// Returns whether the given cell was drawn since the last refresh (or markClean()).
+	public: bool isCellDirty(int column, int line) const;
+	
+	
+	// Returns the range of pixel rows [top, bottom) that contains every cell drawn since
+	// the last refresh, where top == bottom == 0 if there is none.
+	public: int getDirtyTop() const;
+	
+	public: int getDirtyBottom() const;
+	
+	
+	// Forgets the drawn cells, e.g. after the whole image was drawn to the panel by other means.
+	public: void markClean();
+	
+	
+	// Updates the dirty pixel rows of the panel with updateRegion() over the full width (which
+	// only drives the rows where a pixel changed), and marks the cells clean if it succeeds.
+	// Returns OK without powering on the panel if no cell was drawn. The canvas must be the
+	// image of the given driver (with the same dimensions), and its previous image must be
+	// available (in previousPixels or previousStore).
+	public: EpaperDriver::Status refresh(EpaperDriver &epd);
+	
+	
+	// Starts the refresh of refresh() with beginUpdateRegion(), and marks the cells clean if
+	// it has started (or there was nothing to draw). Nothing must be drawn into the canvas
+	// until the driver has finished the refresh.
+	public: EpaperDriver::Status beginRefresh(EpaperDriver &epd);
+	
+	
+	// Moves the cursor to the start of the next line, scrolling if it is on the last line.
+	private: void newLine();
+	
+	
+	// Records that the given cell was drawn.
+	private: void markCell(int column, int line);
+	
+};